@@ -0,0 +1,205 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "forces.h"
+#include "scene.h"
+#include "shapes.h"
+
+#define G 100
+#define WIDTH 4000
+#define HEIGHT 2000
+#define MIN_MASS 1
+#define MAX_MASS 10
+#define BODY_RADIUS 5
+// Ticks timed per run, after the first one whose forces are compared
+#define TIMED_TICKS 20
+#define DT 0.001
+// Relative error allowed between the theta = 0 field and the pairwise forces,
+// which only differ in the order the terms are summed
+#define EXACT_TOLERANCE 1e-9
+
+/**
+ * Compares the Barnes-Hut gravity field against a Newtonian gravity force
+ * creator on every pair of bodies, for several opening angles theta.
+ * For each, reports the time per tick and how far the field's forces are
+ * from the pairwise ones on the first tick, and checks that theta = 0
+ * gives the pairwise forces up to rounding.
+ * Errors are relative to each body's pairwise force, except the last
+ * column's, which is relative to the root mean square force: a body whose
+ * pulls nearly cancel out can have a large relative error in a tiny force.
+ *
+ * Usage: bench_gravity [threads]
+ */
+
+const size_t BODY_COUNTS[] = {100, 500, 2000};
+
+const double THETAS[] = {0, 0.3, 0.5, 0.8, 1.0};
+
+/**
+ * A force creator that copies out the forces on every body.
+ * Added after the gravity, so it sees the total gravitational force.
+ *
+ * @param scene  the scene whose bodies to record.
+ * @param forces where to copy the forces, one per body.
+ * @param done   whether the forces have been recorded, so only
+ *   the first tick is.
+ */
+typedef struct {
+    Scene *scene;
+    Vector *forces;
+    bool done;
+} force_record;
+
+void record_forces(force_record *record) {
+    if (record->done) {
+        return;
+    }
+    for (size_t i = 0; i < scene_bodies(record->scene); i++) {
+        record->forces[i] = body_get_force(scene_get_body(record->scene, i));
+    }
+    record->done = true;
+}
+
+double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+double random_between(double low, double high) {
+    return low + (high - low) * rand() / RAND_MAX;
+}
+
+/**
+ * Places the bodies: half spread over the whole screen and half in a few
+ * tight clusters, where the far field approximation matters most.
+ */
+void make_bodies(Vector *positions, double *masses, size_t count) {
+    Vector clusters[4];
+    for (size_t c = 0; c < 4; c++) {
+        clusters[c] = (Vector) {random_between(500, WIDTH - 500),
+            random_between(500, HEIGHT - 500)};
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (i % 2 == 0) {
+            positions[i] = (Vector) {random_between(0, WIDTH),
+                random_between(0, HEIGHT)};
+        } else {
+            Vector center = clusters[i / 2 % 4];
+            positions[i] = (Vector) {center.x + random_between(-200, 200),
+                center.y + random_between(-200, 200)};
+        }
+        masses[i] = random_between(MIN_MASS, MAX_MASS);
+    }
+}
+
+/**
+ * Runs the bodies under the pairwise creators (theta < 0)
+ * or a field with the given theta.
+ * Records the first tick's forces and returns the time per tick.
+ */
+double run(Vector *positions, double *masses, size_t count, double theta,
+    size_t threads, Vector *forces) {
+    Scene *scene = scene_init();
+    scene_set_threads(scene, threads);
+    Body **bodies = malloc(count * sizeof(Body *));
+    assert(bodies != NULL);
+    for (size_t i = 0; i < count; i++) {
+        bodies[i] = circle_shape(BODY_RADIUS, masses[i],
+            (RGBColor) {1, 1, 1}, positions[i], BULLET1);
+        scene_add_body(scene, bodies[i]);
+    }
+
+    if (theta < 0) {
+        for (size_t i = 0; i < count; i++) {
+            for (size_t j = i + 1; j < count; j++) {
+                create_newtonian_gravity(scene, G, bodies[i], bodies[j]);
+            }
+        }
+    } else {
+        GravityField *field = create_gravity_field(scene, G, theta);
+        for (size_t i = 0; i < count; i++) {
+            gravity_field_add_body(field, bodies[i]);
+        }
+    }
+
+    force_record *record = malloc(sizeof(force_record));
+    assert(record != NULL);
+    record->scene = scene;
+    record->forces = forces;
+    record->done = false;
+    scene_add_force_creator(scene, (ForceCreator) record_forces, record, free);
+
+    scene_tick(scene, DT);
+    double start = now();
+    for (size_t t = 0; t < TIMED_TICKS; t++) {
+        scene_tick(scene, DT);
+    }
+    double elapsed = (now() - start) / TIMED_TICKS;
+
+    scene_free(scene);
+    free(bodies);
+    return elapsed;
+}
+
+int main(int argc, char *argv[]) {
+    size_t threads = argc > 1 ? (size_t) atoi(argv[1]) : 0;
+    srand(21);
+    bool exact = true;
+    printf("%6s %8s %10s %8s %12s %12s %12s\n", "bodies", "theta",
+        "ms/tick", "speedup", "mean error", "max error", "max / rms");
+
+    for (size_t c = 0; c < sizeof(BODY_COUNTS) / sizeof(size_t); c++) {
+        size_t count = BODY_COUNTS[c];
+        Vector *positions = malloc(count * sizeof(Vector));
+        double *masses = malloc(count * sizeof(double));
+        Vector *pairwise = malloc(count * sizeof(Vector));
+        Vector *field = malloc(count * sizeof(Vector));
+        assert(positions != NULL && masses != NULL && pairwise != NULL
+            && field != NULL);
+        make_bodies(positions, masses, count);
+
+        double pairwise_time = run(positions, masses, count, -1, threads,
+            pairwise);
+        printf("%6zu %8s %10.3f %7.2fx\n", count, "pairwise",
+            pairwise_time * 1e3, 1.0);
+
+        for (size_t k = 0; k < sizeof(THETAS) / sizeof(double); k++) {
+            double time = run(positions, masses, count, THETAS[k], threads,
+                field);
+
+            // Error of each body's force relative to its pairwise force
+            double total_error = 0;
+            double max_error = 0;
+            double max_difference = 0;
+            double total_squared = 0;
+            for (size_t i = 0; i < count; i++) {
+                double difference = vec_magnitude(vec_subtract(field[i],
+                    pairwise[i]));
+                double error = difference / vec_magnitude(pairwise[i]);
+                total_error += error;
+                max_error = fmax(max_error, error);
+                max_difference = fmax(max_difference, difference);
+                total_squared += vec_dot(pairwise[i], pairwise[i]);
+            }
+            double rms = sqrt(total_squared / count);
+            if (THETAS[k] == 0 && !(max_error <= EXACT_TOLERANCE)) {
+                exact = false;
+            }
+            printf("%6zu %8.2f %10.3f %7.2fx %12.3e %12.3e %12.3e\n", count,
+                THETAS[k], time * 1e3, pairwise_time / time,
+                total_error / count, max_error, max_difference / rms);
+        }
+
+        free(positions);
+        free(masses);
+        free(pairwise);
+        free(field);
+    }
+
+    printf("theta = 0 %s the pairwise forces\n",
+        exact ? "matches" : "DOES NOT match");
+    return exact ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "projection.h"
+
+// Number of different polygons per vertex count, so the data is not
+// all in one cache line
+#define POLYGONS 256
+// Number of axes each polygon is projected onto per round
+#define AXES 16
+// Minimum time spent timing each kernel on each vertex count
+#define MIN_SECONDS 0.2
+
+/**
+ * Times the SSE2 and AVX2 projection kernels against the scalar one,
+ * and checks that all of them give bit-identical results.
+ * The vertex counts are those of the game's bodies: boxes, stars,
+ * bullets and the outlines of circles.
+ */
+
+const size_t VERTEX_COUNTS[] = {4, 5, 10, 20, 50, 200};
+
+const char *KERNEL_NAMES[] = {"scalar", "sse2", "avx2"};
+
+double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+double random_between(double low, double high) {
+    return low + (high - low) * rand() / RAND_MAX;
+}
+
+// Fills polygons with randomly placed, sized and rotated regular polygons
+void make_polygons(Vector *vertices, size_t count) {
+    for (size_t p = 0; p < POLYGONS; p++) {
+        Vector center = {random_between(0, 4000), random_between(0, 2000)};
+        double radius = random_between(10, 200);
+        double turn = random_between(0, 2 * M_PI);
+        for (size_t i = 0; i < count; i++) {
+            double theta = turn + 2 * M_PI * i / count;
+            vertices[p * count + i] = (Vector) {
+                center.x + radius * cos(theta),
+                center.y + radius * sin(theta)};
+        }
+    }
+}
+
+// Runs a kernel over every polygon and axis once, returning a checksum
+// so the calls cannot be optimized away
+double run_round(ProjectionKernel kernel, Vector *vertices, size_t count,
+    Vector *axes) {
+    double sum = 0;
+    for (size_t p = 0; p < POLYGONS; p++) {
+        for (size_t a = 0; a < AXES; a++) {
+            Projection res = kernel(vertices + p * count, count, axes[a]);
+            sum += res.max - res.min;
+        }
+    }
+    return sum;
+}
+
+// Returns the number of projections whose min or max differ in any bit
+// from the scalar kernel's
+size_t count_mismatches(ProjectionKernel kernel, Vector *vertices,
+    size_t count, Vector *axes) {
+    size_t mismatches = 0;
+    for (size_t p = 0; p < POLYGONS; p++) {
+        for (size_t a = 0; a < AXES; a++) {
+            Projection want = project_vertices_scalar(vertices + p * count,
+                count, axes[a]);
+            Projection got = kernel(vertices + p * count, count, axes[a]);
+            if (memcmp(&want.min, &got.min, sizeof(double)) != 0
+                || memcmp(&want.max, &got.max, sizeof(double)) != 0) {
+                mismatches++;
+            }
+        }
+    }
+    return mismatches;
+}
+
+// Returns the average time of one projection, in nanoseconds
+double time_kernel(ProjectionKernel kernel, Vector *vertices, size_t count,
+    Vector *axes, double *checksum) {
+    size_t rounds = 0;
+    double start = now();
+    double elapsed;
+    do {
+        *checksum += run_round(kernel, vertices, count, axes);
+        rounds++;
+        elapsed = now() - start;
+    } while (elapsed < MIN_SECONDS);
+    return elapsed * 1e9 / (rounds * POLYGONS * AXES);
+}
+
+int main(void) {
+    srand(24);
+    Vector axes[AXES];
+    for (size_t a = 0; a < AXES; a++) {
+        double theta = random_between(0, 2 * M_PI);
+        axes[a] = (Vector) {cos(theta), sin(theta)};
+    }
+
+    bool identical = true;
+    double checksum = 0;
+    printf("%8s %8s %10s %8s %10s\n", "vertices", "kernel", "ns/call",
+        "speedup", "mismatches");
+
+    for (size_t c = 0; c < sizeof(VERTEX_COUNTS) / sizeof(size_t); c++) {
+        size_t count = VERTEX_COUNTS[c];
+        Vector *vertices = malloc(POLYGONS * count * sizeof(Vector));
+        assert(vertices != NULL);
+        make_polygons(vertices, count);
+
+        double scalar_time = 0;
+        for (ProjectionKernelType type = PROJECTION_SCALAR;
+            type <= PROJECTION_AVX2; type++) {
+            ProjectionKernel kernel = projection_get_kernel(type);
+            if (kernel == NULL) {
+                printf("%8zu %8s %10s\n", count, KERNEL_NAMES[type],
+                    "unsupported");
+                continue;
+            }
+
+            size_t mismatches = count_mismatches(kernel, vertices, count,
+                axes);
+            identical = identical && mismatches == 0;
+            double time = time_kernel(kernel, vertices, count, axes,
+                &checksum);
+            if (type == PROJECTION_SCALAR) {
+                scalar_time = time;
+            }
+            printf("%8zu %8s %10.2f %7.2fx %10zu\n", count,
+                KERNEL_NAMES[type], time, scalar_time / time, mismatches);
+        }
+        free(vertices);
+    }
+
+    printf("results %s (checksum %g)\n",
+        identical ? "bit-identical" : "DIFFER", checksum);
+    return identical ? 0 : 1;
+}
@@ -38,6 +38,11 @@
 #define BULLET_WALL_ELAS 0.95
 #define TANK_WALL_ELAS 0.4 
 #define INFINITE_MASS INFINITY
+#define COLLISION_THREADS 3 // worker threads for the collision tests
+// collision categories of the kinds of bodies that collide
+#define WALLS (body_type_category(WALL) | body_type_category(WALL_BREAK))
+#define TANKS (body_type_category(ONE) | body_type_category(TWO))
+#define BULLETS (body_type_category(BULLET1) | body_type_category(BULLET2))
 
 const Vector MIN = {.x = 0, .y = 0};
 const Vector MAX = {.x = WIDTH, .y = HEIGHT};
@@ -64,8 +69,7 @@ Mix_Chunk *shoot = NULL;
  * @parma n     the index of the desired body.
  */
 BodyType get_nth_bodytype(Scene *scene, size_t n) {
-    Body_info *tmp = body_get_info(scene_get_body(scene, n));
-    return (*tmp).b;
+    return body_get_tag(scene_get_body(scene, n));
 }
 
 void set_rotation(Body *p) {
@@ -116,25 +120,16 @@ void shoot_bullet(Scene *scene, Body *tank_primary, Body *tank_secondary,
         turret_color = TURRET2_COLOR;
     }
 
-    bullet = n_polygon_shape(20, 20, 10,
+    bullet = circle_shape(20, 10,
             turret_color, vec_add(body_get_centroid(tank_primary), 
                 (Vector) {.x = cos(angle) * centroid_offset, 
                     .y = sin(angle) * centroid_offset}), b);
     body_set_velocity(bullet, (Vector) {.x = cos(angle) * bullet_velocity, 
         .y = sin(angle) * bullet_velocity});
+    body_set_mask(bullet, WALLS | TANKS);
 
-    // create physics collision between bullet and walls
-    for (int i = 0; i < scene_bodies(scene); i++) {
-        if (get_nth_bodytype(scene, i) == WALL || 
-            get_nth_bodytype(scene, i) == WALL_BREAK) {
-            Body *wall = scene_get_body(scene, i);
-            create_physics_collision(scene, BULLET_WALL_ELAS, wall, bullet);
-        }
-    }
-
-    // create destruction force between bullet and both tanks
-    create_destructive_collision(scene, tank_primary, bullet);
-    create_destructive_collision(scene, tank_secondary, bullet);
+    // collisions with the walls and tanks come from the responses
+    // registered in register_collisions()
     scene_add_body(scene, bullet);
 
 }
@@ -378,6 +373,8 @@ void check_boundary(Scene *scene) {
 void draw_background(Scene *scene) {
     Body *b1 = rectangle_shape((Vector) {.x = WIDTH / 2, .y = HEIGHT / 2}, 
         INFINITE_MASS, WIDTH, HEIGHT, BACKGROUND_COLOR, BACKGROUND);
+    // the background overlaps everything but never collides
+    body_set_mask(b1, 0);
     scene_add_body(scene, b1);
 }
 
@@ -398,6 +395,7 @@ void draw_walls(Scene *scene) {
         Body *b1 = rectangle_shape((Vector) {.x = WIDTH / 2, .y = (HEIGHT / 2) 
             - (3.5 * WALL_LENGTH) + (i * (WALL_LENGTH + 10))}, INFINITE_MASS,
             WALL_LENGTH, WALL_LENGTH, wall_c, wall_type);
+        body_set_mask(b1, TANKS | BULLETS);
         scene_add_body(scene, b1);
     }
 
@@ -410,6 +408,10 @@ void draw_walls(Scene *scene) {
         INFINITE_MASS, WALL_LENGTH * 2, WALL_LENGTH * 2, SHRUB_COLOR, WALL);
     Body *shrub3 = rectangle_shape((Vector) {.x = 700, .y = 400}, 
         INFINITE_MASS, WALL_LENGTH * 2, WALL_LENGTH * 2, SHRUB_COLOR, WALL);
+    body_set_mask(shrub, TANKS | BULLETS);
+    body_set_mask(shrub1, TANKS | BULLETS);
+    body_set_mask(shrub2, TANKS | BULLETS);
+    body_set_mask(shrub3, TANKS | BULLETS);
     scene_add_body(scene, shrub);
     scene_add_body(scene, shrub1);
     scene_add_body(scene, shrub2);
@@ -426,6 +428,10 @@ void draw_boundaries(Scene *scene) {
         20, HEIGHT, WHITE_COLOR, WALL);
     Body *b4 = rectangle_shape((Vector) {.x = WIDTH, .y = HEIGHT/2}, 
         INFINITE_MASS, 20, HEIGHT, WHITE_COLOR, WALL);
+    body_set_mask(b1, TANKS | BULLETS);
+    body_set_mask(b2, TANKS | BULLETS);
+    body_set_mask(b3, TANKS | BULLETS);
+    body_set_mask(b4, TANKS | BULLETS);
     scene_add_body(scene, b1);
     scene_add_body(scene, b2);
     scene_add_body(scene, b3);
@@ -448,19 +454,11 @@ void draw_tanks(Scene *scene) {
     body_set_velocity(tank2, PLAYER_START_VELOCITY);
     body_set_velocity(turret1, PLAYER_START_VELOCITY);
     body_set_velocity(turret2, PLAYER_START_VELOCITY);
-
-    // create physics collisions between two tanks
-    create_physics_collision(scene, TANK_TANK_ELAS, tank1, tank2);
-
-    // create physics collisions between walls and tanks
-    for (int i = 0; i < scene_bodies(scene); i++) {
-        if (get_nth_bodytype(scene, i) == WALL || 
-            get_nth_bodytype(scene, i) == WALL_BREAK) {
-            Body *w = scene_get_body(scene, i);
-            create_physics_collision(scene, TANK_WALL_ELAS, tank1, w);
-            create_physics_collision(scene, TANK_WALL_ELAS, tank2, w);
-        }
-    }
+    body_set_mask(tank1, WALLS | TANKS | BULLETS);
+    body_set_mask(tank2, WALLS | TANKS | BULLETS);
+    // the turrets sit on the tanks and never collide
+    body_set_mask(turret1, 0);
+    body_set_mask(turret2, 0);
 
     // add bodies to the scene
     scene_add_body(scene, tank1);
@@ -532,9 +530,52 @@ bool check_explosion(Scene *scene) {
     return false;
 }
 
+/**
+ * Counts a bullet's bounce off a wall. A bullet disappears on its fourth
+ * bounce, and a breakable wall cracks a little with each hit until the third.
+ * Runs once the scene has found all of the tick's collisions, so it can
+ * remove bodies without affecting the other pairs.
+ */
+void bullet_wall_handler(Body *wall, Body *bullet, Vector axis, void *aux) {
+    if (get_num_collided(bullet) >= 3) {
+        body_remove(bullet);
+    }
+    else {
+        increment_num_collided(bullet);
+    }
+
+    if (body_get_tag(wall) == WALL_BREAK) {
+        if (get_num_collided(wall) >= 2) {
+            body_remove(wall);
+        }
+        else {
+            increment_num_collided(wall);
+            RGBColor color = body_get_color(wall);
+            RGBColor new_color = {.r = color.r, .g = color.g + 0.15, .b = color.b};
+            body_set_color(wall, new_color);
+        }
+    }
+}
+
+// Registers the collisions between the kinds of bodies, once per scene
+void register_collisions(Scene *scene) {
+    create_category_physics_collision(scene, TANK_TANK_ELAS,
+        body_type_category(ONE), body_type_category(TWO));
+    create_category_physics_collision(scene, TANK_WALL_ELAS, TANKS, WALLS);
+    create_category_physics_collision(scene, BULLET_WALL_ELAS, WALLS, BULLETS);
+    create_category_collision(scene, WALLS, BULLETS, bullet_wall_handler,
+        NULL, NULL);
+    create_category_destructive_collision(scene, TANKS, BULLETS);
+}
+
 // Start the game and return all scene components
 Scene *create_game() {
     Scene *scene = scene_init();
+    // walls never move and tanks are slow, so their padded leaves stay put;
+    // only the fast bullets get reinserted into the tree
+    scene_set_broadphase(scene, BROADPHASE_AABB_TREE);
+    scene_set_threads(scene, COLLISION_THREADS);
+    register_collisions(scene);
     sdl_init(MIN, MAX);
     sdl_on_key(on_key, scene);
     draw_background(scene);
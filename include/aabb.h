@@ -0,0 +1,83 @@
+#ifndef __AABB_H__
+#define __AABB_H__
+
+#include <stdbool.h>
+#include "list.h"
+#include "polygon.h"
+#include "vector.h"
+
+/**
+ * An axis-aligned bounding box.
+ * Used by the broadphase to cheaply rule out pairs of bodies
+ * that cannot possibly be colliding.
+ */
+typedef struct {
+    /** The bottom left corner of the box */
+    Vector min;
+    /** The top right corner of the box */
+    Vector max;
+} AABB;
+
+/**
+ * Computes the smallest box containing all the vertices of a polygon.
+ *
+ * @param polygon the list of vertices that make up the polygon
+ * @return the bounding box of the polygon
+ */
+AABB aabb_from_polygon(List *polygon);
+
+/**
+ * Computes the smallest box containing all the vertices of a packed polygon.
+ *
+ * @param polygon the packed polygon
+ * @return the bounding box of the polygon
+ */
+AABB aabb_from_polygon_packed(Polygon *polygon);
+
+/**
+ * Determines whether two boxes overlap.
+ * Boxes that only touch along an edge are considered overlapping.
+ *
+ * @param box1 the first box
+ * @param box2 the second box
+ * @return whether the boxes overlap
+ */
+bool aabb_overlaps(AABB box1, AABB box2);
+
+/**
+ * Determines whether one box lies entirely inside another.
+ *
+ * @param outer the containing box
+ * @param inner the contained box
+ * @return whether every point of inner is also in outer
+ */
+bool aabb_contains(AABB outer, AABB inner);
+
+/**
+ * Computes the smallest box containing two boxes.
+ *
+ * @param box1 the first box
+ * @param box2 the second box
+ * @return the union of the boxes
+ */
+AABB aabb_union(AABB box1, AABB box2);
+
+/**
+ * Grows a box by the same margin on every side.
+ *
+ * @param box the box to grow
+ * @param margin the distance to move each edge outwards
+ * @return the grown box
+ */
+AABB aabb_expand(AABB box, double margin);
+
+/**
+ * Computes the perimeter of a box.
+ * This is the cost the AABB tree tries to keep small when inserting.
+ *
+ * @param box the box
+ * @return twice the sum of the box's width and height
+ */
+double aabb_perimeter(AABB box);
+
+#endif // #ifndef __AABB_H__
@@ -0,0 +1,88 @@
+#ifndef __AABB_TREE_H__
+#define __AABB_TREE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "aabb.h"
+#include "body.h"
+#include "broadphase.h"
+
+/**
+ * A dynamic bounding volume hierarchy over bodies.
+ * Each body is a leaf whose box is padded by a margin ("fattened"),
+ * so a moving body only has to be reinserted once it leaves its padded box.
+ * Every internal node holds the union of its children's boxes,
+ * and the tree is kept balanced, so region queries take O(log n) time.
+ */
+typedef struct aabb_tree AABBTree;
+
+/**
+ * Allocates memory for an empty AABB tree.
+ * Asserts that the margin is non-negative and that the memory is allocated.
+ *
+ * @param margin how far to pad each body's box on every side.
+ *   Larger margins mean fewer reinsertions but more false candidate pairs.
+ * @return the new tree
+ */
+AABBTree *aabb_tree_init(double margin);
+
+/**
+ * Releases the memory allocated for an AABB tree.
+ * Does not free the bodies inserted into it.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ */
+void aabb_tree_free(AABBTree *tree);
+
+/**
+ * Adds a body to an AABB tree.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @param body the body to add
+ * @param bounds the body's current bounding box
+ * @return a proxy identifying the body's leaf in later calls
+ */
+size_t aabb_tree_insert(AABBTree *tree, Body *body, AABB bounds);
+
+/**
+ * Removes a body's leaf from an AABB tree.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @param proxy the proxy returned when the body was inserted
+ */
+void aabb_tree_remove(AABBTree *tree, size_t proxy);
+
+/**
+ * Records a body's new bounding box after it has moved.
+ * The leaf is only reinserted if the box has left the leaf's padded box.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @param proxy the proxy returned when the body was inserted
+ * @param bounds the body's current bounding box
+ * @return whether the leaf had to be reinserted
+ */
+bool aabb_tree_update(AABBTree *tree, size_t proxy, AABB bounds);
+
+/**
+ * Calls a function on every body whose bounding box overlaps a region.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @param region the box to search
+ * @param callback the function to call on each body found
+ * @param aux an auxiliary value to pass to callback
+ */
+void aabb_tree_query(
+    AABBTree *tree, AABB region, BodyCallback callback, void *aux
+);
+
+/**
+ * Calls a function on every pair of bodies in the tree
+ * whose bounding boxes overlap. Each pair is reported once.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @param callback the function to call on each overlapping pair
+ * @param aux an auxiliary value to pass to callback
+ */
+void aabb_tree_find_pairs(AABBTree *tree, PairCallback callback, void *aux);
+
+#endif // #ifndef __AABB_TREE_H__
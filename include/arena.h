@@ -0,0 +1,73 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+
+/**
+ * A bump allocator for short-lived allocations, such as the scratch buffers
+ * used while ticking or rendering a single frame.
+ * Allocating just advances an offset into a block of memory,
+ * and everything is released at once by arena_reset().
+ *
+ * If an allocation does not fit, it is taken from a separate overflow block.
+ * The next arena_reset() frees the overflow blocks and grows the main block
+ * to cover them, so an arena stops calling malloc() once it has seen
+ * the most memory a frame needs.
+ */
+typedef struct arena Arena;
+
+/**
+ * Allocates a new arena.
+ * Asserts that the required memory was allocated.
+ *
+ * @param capacity the number of bytes the arena initially has room for
+ * @return a pointer to the newly allocated arena
+ */
+Arena *arena_init(size_t capacity);
+
+/**
+ * Releases the memory allocated for an arena,
+ * including everything that was allocated from it.
+ *
+ * @param arena a pointer to an arena returned from arena_init()
+ */
+void arena_free(Arena *arena);
+
+/**
+ * Allocates memory from an arena.
+ * The memory is aligned for any type and stays valid until the arena is
+ * reset or released past this allocation. It must not be passed to free().
+ *
+ * @param arena a pointer to an arena returned from arena_init()
+ * @param size the number of bytes to allocate
+ * @return a pointer to the allocated memory
+ */
+void *arena_alloc(Arena *arena, size_t size);
+
+/**
+ * Records how much of an arena is currently in use,
+ * so the allocations made after this point can be released together.
+ *
+ * @param arena a pointer to an arena returned from arena_init()
+ * @return a mark to pass to arena_release()
+ */
+size_t arena_mark(Arena *arena);
+
+/**
+ * Releases all allocations made from an arena since a call to arena_mark().
+ * Overflow blocks are kept until the next arena_reset().
+ *
+ * @param arena a pointer to an arena returned from arena_init()
+ * @param mark a value returned from arena_mark() on this arena
+ *   since the last arena_reset()
+ */
+void arena_release(Arena *arena, size_t mark);
+
+/**
+ * Releases all allocations made from an arena.
+ *
+ * @param arena a pointer to an arena returned from arena_init()
+ */
+void arena_reset(Arena *arena);
+
+#endif // #ifndef __ARENA_H__
@@ -0,0 +1,150 @@
+#ifndef __ARRAY_H__
+#define __ARRAY_H__
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Declares a growable array type that stores elements of one type by value,
+ * along with the functions that operate on it.
+ * Unlike List, the elements are not individually allocated or cast to void*,
+ * and the functions are static inline, so accessing an element compiles down
+ * to a single load in the caller. This makes it suitable for inner loops.
+ * The array struct is meant to be embedded by value in other structs.
+ *
+ * For example, ARRAY_DEFINE(VectorArray, Vector, vector_array) declares:
+ *     typedef struct { Vector *data; size_t size; size_t capacity; } VectorArray;
+ *     void vector_array_init(VectorArray *array, size_t initial_capacity);
+ *     void vector_array_free(VectorArray *array);
+ *     void vector_array_reserve(VectorArray *array, size_t capacity);
+ *     void vector_array_shrink(VectorArray *array);
+ *     void vector_array_add(VectorArray *array, Vector value);
+ *     void vector_array_append(VectorArray *array, const Vector *values,
+ *         size_t count);
+ *     Vector vector_array_get(VectorArray *array, size_t index);
+ *     Vector vector_array_remove(VectorArray *array, size_t index);
+ *     Vector vector_array_swap_remove(VectorArray *array, size_t index);
+ *     size_t vector_array_remove_if(VectorArray *array,
+ *         bool (*pred)(Vector, void *), void *aux);
+ *     void vector_array_clear(VectorArray *array);
+ *
+ * init() allocates space for initial_capacity elements (at least one).
+ * free() releases the element storage but not anything the elements own.
+ *   The array is left empty and can be added to again.
+ * reserve() makes room for at least capacity elements without reallocating.
+ * shrink() releases any capacity beyond the current size.
+ * add() and append() add elements to the end, doubling capacity as needed.
+ * get() asserts that the index is valid; ARRAY_AT() is the unchecked version.
+ * remove() removes an element, moving all subsequent elements back by one.
+ * swap_remove() removes an element in O(1) by moving the last element
+ *   into its place, so it does not preserve the order of the elements.
+ * remove_if() removes every element for which pred(element, aux) returns true
+ *   in one pass, keeping the other elements in order, and returns how many
+ *   were removed. pred may release the elements it removes,
+ *   but must not add to or remove from the array itself.
+ * clear() removes all elements but keeps the capacity.
+ */
+#define ARRAY_DEFINE(Name, Type, prefix) \
+typedef struct { \
+    Type *data; \
+    size_t size; \
+    size_t capacity; \
+} Name; \
+\
+static inline void prefix##_init(Name *array, size_t initial_capacity) { \
+    initial_capacity = initial_capacity == 0 ? 1 : initial_capacity; \
+    array->data = malloc(initial_capacity * sizeof(Type)); \
+    assert(array->data != NULL); \
+    array->size = 0; \
+    array->capacity = initial_capacity; \
+} \
+\
+static inline void prefix##_free(Name *array) { \
+    free(array->data); \
+    array->data = NULL; \
+    array->size = 0; \
+    array->capacity = 0; \
+} \
+\
+static inline void prefix##_reserve(Name *array, size_t capacity) { \
+    if (capacity <= array->capacity) { \
+        return; \
+    } \
+    array->data = realloc(array->data, capacity * sizeof(Type)); \
+    assert(array->data != NULL); \
+    array->capacity = capacity; \
+} \
+\
+static inline void prefix##_shrink(Name *array) { \
+    size_t capacity = array->size == 0 ? 1 : array->size; \
+    array->data = realloc(array->data, capacity * sizeof(Type)); \
+    assert(array->data != NULL); \
+    array->capacity = capacity; \
+} \
+\
+static inline void prefix##_add(Name *array, Type value) { \
+    if (array->size == array->capacity) { \
+        prefix##_reserve(array, \
+            array->capacity == 0 ? 1 : 2 * array->capacity); \
+    } \
+    array->data[array->size++] = value; \
+} \
+\
+static inline void prefix##_append(Name *array, const Type *values, \
+    size_t count) { \
+    if (array->size + count > array->capacity) { \
+        size_t capacity = array->capacity == 0 ? 1 : 2 * array->capacity; \
+        prefix##_reserve(array, capacity > array->size + count \
+            ? capacity : array->size + count); \
+    } \
+    memcpy(array->data + array->size, values, count * sizeof(Type)); \
+    array->size += count; \
+} \
+\
+static inline Type prefix##_get(Name *array, size_t index) { \
+    assert(index < array->size); \
+    return array->data[index]; \
+} \
+\
+static inline Type prefix##_remove(Name *array, size_t index) { \
+    assert(index < array->size); \
+    Type res = array->data[index]; \
+    memmove(array->data + index, array->data + index + 1, \
+        (array->size - index - 1) * sizeof(Type)); \
+    array->size--; \
+    return res; \
+} \
+\
+static inline Type prefix##_swap_remove(Name *array, size_t index) { \
+    assert(index < array->size); \
+    Type res = array->data[index]; \
+    array->data[index] = array->data[--array->size]; \
+    return res; \
+} \
+\
+static inline size_t prefix##_remove_if(Name *array, \
+    bool (*pred)(Type, void *), void *aux) { \
+    size_t kept = 0; \
+    for (size_t i = 0; i < array->size; i++) { \
+        if (!pred(array->data[i], aux)) { \
+            array->data[kept++] = array->data[i]; \
+        } \
+    } \
+    size_t removed = array->size - kept; \
+    array->size = kept; \
+    return removed; \
+} \
+\
+static inline void prefix##_clear(Name *array) { \
+    array->size = 0; \
+}
+
+/**
+ * Accesses an element of an array declared with ARRAY_DEFINE()
+ * without checking the index. Can be assigned to.
+ */
+#define ARRAY_AT(array, index) ((array)->data[(index)])
+
+#endif // #ifndef __ARRAY_H__
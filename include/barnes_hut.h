@@ -0,0 +1,88 @@
+#ifndef __BARNES_HUT_H__
+#define __BARNES_HUT_H__
+
+#include <stddef.h>
+#include "vector.h"
+
+/**
+ * A Barnes-Hut quadtree over point masses, for approximating
+ * inverse-square fields such as gravity in O(n log n) time.
+ * Each cell of the tree stores the total mass and center of mass of the
+ * points inside it, so a cell that is far enough from a query point
+ * can stand in for all of its points at once.
+ *
+ * The tree is meant to be rebuilt every tick: clear it, add every point,
+ * then build it. Its memory is reused between builds.
+ */
+typedef struct barnes_hut BarnesHut;
+
+/**
+ * Allocates memory for an empty Barnes-Hut tree.
+ * Asserts that the required memory was allocated.
+ *
+ * @return the new tree
+ */
+BarnesHut *barnes_hut_init(void);
+
+/**
+ * Releases the memory allocated for a Barnes-Hut tree.
+ *
+ * @param tree a pointer to a tree returned from barnes_hut_init()
+ */
+void barnes_hut_free(BarnesHut *tree);
+
+/**
+ * Removes all points from a Barnes-Hut tree.
+ *
+ * @param tree a pointer to a tree returned from barnes_hut_init()
+ */
+void barnes_hut_clear(BarnesHut *tree);
+
+/**
+ * Adds a point mass to a Barnes-Hut tree.
+ * The point is not used by queries until the next barnes_hut_build().
+ * Asserts that the mass is finite and non-negative.
+ *
+ * @param tree a pointer to a tree returned from barnes_hut_init()
+ * @param position the point's position
+ * @param mass the point's mass
+ * @return the point's index, counting from 0 since the last clear
+ */
+size_t barnes_hut_add(BarnesHut *tree, Vector position, double mass);
+
+/**
+ * Builds the quadtree over the points added since the last clear.
+ *
+ * @param tree a pointer to a tree returned from barnes_hut_init()
+ */
+void barnes_hut_build(BarnesHut *tree);
+
+/**
+ * Approximates the field of all points in a tree at a position,
+ * i.e. the sum of m * r / |r|^3 over every point of mass m,
+ * where r is the vector from the position to the point.
+ * Multiplying it by G and the mass at the position gives the gravitational
+ * force there.
+ *
+ * A cell is approximated by its center of mass if the position is outside
+ * the cell and the cell's width divided by the distance to its center of mass
+ * is less than theta. A theta of 0 sums over every point exactly;
+ * around 0.5 is the usual tradeoff between accuracy and speed.
+ * Does not modify the tree, so several threads may query it at once.
+ *
+ * @param tree a pointer to a tree returned from barnes_hut_init()
+ *   and built with barnes_hut_build()
+ * @param position where to evaluate the field
+ * @param theta the opening angle; asserted to be non-negative
+ * @param min_distance points and cells at most this far away are ignored,
+ *   since the field blows up as the distance goes to 0
+ * @param skip the index of the point at the position, which is left out,
+ *   or a value past the last index if there is none
+ * @return the field at the position
+ */
+Vector barnes_hut_field(
+    BarnesHut *tree, Vector position, double theta, double min_distance,
+    size_t skip
+);
+
+#endif // #ifndef __BARNES_HUT_H__
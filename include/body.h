@@ -2,14 +2,18 @@
 #define __BODY_H__
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <assert.h>
 #include <stdlib.h>
 #include <math.h>
 
+#include "aabb.h"
+#include "array.h"
 #include "color.h"
 #include "list.h"
 #include "vector.h"
 #include "polygon.h"
+#include "thread_pool.h"
 
 /**
  * A rigid body constrained to the plane.
@@ -19,6 +23,44 @@
  */
 typedef struct body Body;
 
+// A mask that lets a body interact with every category; see body_set_mask()
+#define ALL_CATEGORIES UINT32_MAX
+
+/**
+ * The kinds of shapes a body can have.
+ * SHAPE_POLYGON bodies are convex polygons.
+ * SHAPE_CIRCLE bodies are exact circles: they collide and draw as circles,
+ * and only use their polygon outline when asked for their vertices.
+ * SHAPE_BOX bodies are rectangles, which collide with each other
+ * using only their half-extents and orientation.
+ */
+typedef enum {
+    SHAPE_POLYGON,
+    SHAPE_CIRCLE,
+    SHAPE_BOX
+} ShapeType;
+
+/**
+ * A growable array of body pointers. See ARRAY_DEFINE() in array.h.
+ */
+ARRAY_DEFINE(BodyArray, Body *, body_array)
+
+/**
+ * A reference to a body that can tell when the body has been freed.
+ * Bodies are allocated from a pool, so a Body* to a freed body may point
+ * at a different body that reused its memory; a handle will not.
+ * See body_get_handle() and body_from_handle().
+ */
+typedef struct {
+    uint32_t index;
+    uint32_t generation;
+} BodyHandle;
+
+/**
+ * A growable array of body handles. See ARRAY_DEFINE() in array.h.
+ */
+ARRAY_DEFINE(BodyHandleArray, BodyHandle, body_handle_array)
+
 /**
  * Initializes a body without any info.
  * Acts like body_init_with_info() where info and info_freer are NULL.
@@ -28,9 +70,12 @@ Body *body_init(List *shape, double mass, RGBColor color);
 /**
  * Allocates memory for a body with the given parameters.
  * The body is initially at rest.
+ * Bodies come from a pool, so this only calls malloc() when every
+ * previously allocated body is still in use.
  * Asserts that the mass is positive and that the required memory is allocated.
  *
- * @param shape a list of vectors describing the initial shape of the body
+ * @param shape a list of vectors describing the initial shape of the body.
+ *   The body stores the vertices as a packed polygon and frees the list.
  * @param mass the mass of the body (if INFINITY, prevents the body from moving)
  * @param color the color of the body, used to draw it on the screen
  * @param info additional information to associate with the body,
@@ -42,13 +87,82 @@ Body *body_init_with_info(
     List *shape, double mass, RGBColor color, void *info, FreeFunc info_freer
 );
 
+/**
+ * Allocates memory for a body whose shape is a packed polygon.
+ * Behaves like body_init_with_info(), but the shape needs no conversion.
+ *
+ * @param shape the vertices of the body's initial shape.
+ *   The body takes ownership of it and frees it in body_free().
+ * @param mass the mass of the body (if INFINITY, prevents the body from moving)
+ * @param color the color of the body, used to draw it on the screen
+ * @param info additional information to associate with the body
+ * @param info_freer if non-NULL, a function call on the info to free it
+ * @return a pointer to the newly allocated body
+ */
+Body *body_init_with_polygon(
+    Polygon *shape, double mass, RGBColor color, void *info,
+    FreeFunc info_freer
+);
+
+/**
+ * Allocates memory for a rectangular body centered at the origin,
+ * with its sides parallel to the axes.
+ * Otherwise behaves like body_init_with_info().
+ *
+ * @param width the width of the rectangle, which must be positive
+ * @param height the height of the rectangle, which must be positive
+ * @param mass the mass of the body (if INFINITY, prevents the body from moving)
+ * @param color the color of the body, used to draw it on the screen
+ * @param info additional information to associate with the body
+ * @param info_freer if non-NULL, a function call on the info to free it
+ * @return a pointer to the newly allocated body
+ */
+Body *body_init_box(
+    double width, double height, double mass, RGBColor color, void *info,
+    FreeFunc info_freer
+);
+
+/**
+ * Allocates memory for a circular body centered at the origin.
+ * Otherwise behaves like body_init_with_info().
+ *
+ * @param radius the radius of the circle, which must be positive
+ * @param mass the mass of the body (if INFINITY, prevents the body from moving)
+ * @param color the color of the body, used to draw it on the screen
+ * @param info additional information to associate with the body
+ * @param info_freer if non-NULL, a function call on the info to free it
+ * @return a pointer to the newly allocated body
+ */
+Body *body_init_circle(
+    double radius, double mass, RGBColor color, void *info,
+    FreeFunc info_freer
+);
+
 /**
  * Releases the memory allocated for a body.
+ * The body's slot goes back to the pool and is reused by the next body
+ * allocated, so any handles to the body stop resolving.
  *
  * @param body a pointer to a body returned from body_init()
  */
 void body_free(Body *body);
 
+/**
+ * Gets a handle to a body.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return a handle that resolves to the body until it is freed
+ */
+BodyHandle body_get_handle(Body *body);
+
+/**
+ * Looks up the body a handle refers to.
+ *
+ * @param handle a handle returned from body_get_handle()
+ * @return the body, or NULL if it has been freed since the handle was made
+ */
+Body *body_from_handle(BodyHandle handle);
+
 /**
  * Gets the current shape of a body.
  * Returns a newly allocated vector list, which must be list_free()d.
@@ -58,6 +172,97 @@ void body_free(Body *body);
  */
 List *body_get_shape(Body *body);
 
+/**
+ * Gets the current shape of a body without copying it.
+ * For a circular body, this is a polygon inscribed in the circle.
+ * The body keeps its vertices at the current position cached,
+ * and only recomputes them after its centroid or angle changes,
+ * so this is cheap to call many times per tick.
+ * The returned polygon is owned by the body: it must not be modified or
+ * freed, and its contents change the next time the body moves.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the polygon describing the body's current position
+ */
+Polygon *body_borrow_polygon(Body *body);
+
+/**
+ * Gets the distinct unit edge normals of a body's current shape,
+ * which are the axes to test when checking it for collisions.
+ * A circular body has none.
+ * They are computed once from the initial shape (see polygon_edge_normals())
+ * and only rotated again after the body's angle changes.
+ * Like body_borrow_polygon(), the result is owned by the body.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the edge normals at the body's current angle
+ */
+Polygon *body_borrow_axes(Body *body);
+
+/**
+ * Gets the kind of shape a body has.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return SHAPE_CIRCLE for bodies from body_init_circle(),
+ *   SHAPE_BOX for bodies from body_init_box(), SHAPE_POLYGON otherwise
+ */
+ShapeType body_get_shape_type(Body *body);
+
+/**
+ * Gets the radius of a circular body.
+ *
+ * @param body a pointer to a body returned from body_init_circle()
+ * @return the radius passed to body_init_circle()
+ */
+double body_get_radius(Body *body);
+
+/**
+ * Determines whether a body's shape is convex.
+ * Circles and boxes are always convex.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return whether the body's shape is convex
+ */
+bool body_is_convex(Body *body);
+
+/**
+ * Gets the half-width and half-height of a rectangular body.
+ *
+ * @param body a pointer to a body returned from body_init_box()
+ * @return half of the width and height passed to body_init_box()
+ */
+Vector body_get_half_extents(Body *body);
+
+/**
+ * Gets the radius of the smallest circle around a body's centroid
+ * that contains its shape. This does not change as the body moves or rotates.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the distance from the centroid to the furthest vertex
+ */
+double body_get_bounding_radius(Body *body);
+
+/**
+ * Gets the axis-aligned bounding box of a body's current shape.
+ * Like body_borrow_polygon(), this does not allocate any memory.
+ * The box is cached relative to the centroid and only recomputed
+ * when the body rotates.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the smallest box containing the body at its current position
+ */
+AABB body_get_aabb(Body *body);
+
+/**
+ * Brings a body's cached world shape, axes and bounding box up to date.
+ * Reading those caches normally updates them on demand,
+ * so a body must be refreshed before several threads read it at once;
+ * until it next moves or rotates, reading it then has no side effects.
+ *
+ * @param body a pointer to a body returned from body_init()
+ */
+void body_refresh_caches(Body *body);
+
 /**
  * Gets the current center of mass of a body.
  * While this could be calculated with polygon_centroid(), that becomes too slow
@@ -149,6 +354,14 @@ void body_set_rate(Body *body, double rate);
  */
 void body_add_force(Body *body, Vector force);
 
+/**
+ * Gets the total force applied to a body so far this tick.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the sum of the forces applied since the body was last ticked
+ */
+Vector body_get_force(Body *body);
+
 /**
  * Applies an impulse to a body.
  * An impulse causes an instantaneous change in velocity,
@@ -161,6 +374,16 @@ void body_add_force(Body *body, Vector force);
  */
 void body_add_impulse(Body *body, Vector impulse);
 
+/**
+ * Gets the total impulse applied to a body so far this tick.
+ * Together with body_get_force(), useful for finding the velocity
+ * the body will have after the tick, as a collision solver needs to.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the sum of the impulses applied since the body was last ticked
+ */
+Vector body_get_impulse(Body *body);
+
 /**
  * Updates the body after a given time interval has elapsed.
  * Sets acceleration and velocity according to the forces and impulses
@@ -174,6 +397,22 @@ void body_add_impulse(Body *body, Vector impulse);
  */
 void body_tick(Body *body, double dt);
 
+/**
+ * Ticks many bodies at once, like calling body_tick() on each of them,
+ * skipping any that have been removed.
+ * Body motion is stored one array per component, so this runs a single
+ * loop over those arrays instead of a function call per body.
+ * Each body's motion only depends on its own state,
+ * so the loop can be split across threads without changing the results.
+ *
+ * @param bodies the bodies to tick
+ * @param count the number of bodies
+ * @param dt the number of seconds elapsed since the last tick
+ * @param pool if non-NULL, the threads to split the loop across
+ */
+void body_tick_batch(Body **bodies, size_t count, double dt,
+    ThreadPool *pool);
+
 /**
  * Marks a body for removal--future calls to body_is_removed() will return true.
  * Does not free the body.
@@ -193,6 +432,88 @@ void body_remove(Body *body);
  */
 bool body_is_removed(Body *body);
 
+/**
+ * Gets the proxy a scene's broadphase uses to keep track of a body.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the value passed to body_set_proxy(),
+ *   or NO_PROXY if the body is not in a persistent broadphase
+ */
+size_t body_get_proxy(Body *body);
+
+/**
+ * Records the proxy a scene's broadphase uses to keep track of a body.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param proxy the proxy, or NO_PROXY once the body leaves the broadphase
+ */
+void body_set_proxy(Body *body, size_t proxy);
+
+/**
+ * Gets a body's tag, a small integer stored in the body itself
+ * that the game can use to tell different kinds of bodies apart.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the value passed to body_set_tag(), or 0 if it was never set
+ */
+int body_get_tag(Body *body);
+
+/**
+ * Sets a body's tag. See body_get_tag().
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param tag the new tag
+ */
+void body_set_tag(Body *body, int tag);
+
+/**
+ * Gets the collision categories a body belongs to, as a set of bits.
+ * Scenes use categories to decide which pairs of nearby bodies
+ * to respond to; see scene_add_category_response().
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the value passed to body_set_category(), or 0 if it was never set
+ */
+uint32_t body_get_category(Body *body);
+
+/**
+ * Sets the collision categories a body belongs to. See body_get_category().
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param category the new category bits
+ */
+void body_set_category(Body *body, uint32_t category);
+
+/**
+ * Gets the set of categories a body may interact with.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the value passed to body_set_mask(), or ALL_CATEGORIES
+ *   if it was never set
+ */
+uint32_t body_get_mask(Body *body);
+
+/**
+ * Sets the set of categories a body may interact with.
+ * A scene skips a nearby pair of bodies (including any pair force creators
+ * between them) unless each body's mask shares a bit with the other's
+ * category. Bodies in no category are never skipped.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param mask the new mask bits
+ */
+void body_set_mask(Body *body, uint32_t mask);
+
+/**
+ * Determines whether two bodies' categories and masks let them interact.
+ * See body_set_mask().
+ *
+ * @param body1 a pointer to a body returned from body_init()
+ * @param body2 a pointer to another body returned from body_init()
+ * @return whether a scene should look at the pair of bodies
+ */
+bool body_masks_match(Body *body1, Body *body2);
+
 // changes the collided status of body
 void body_collided(Body *body, bool stat);
 
@@ -0,0 +1,37 @@
+#ifndef __BROADPHASE_H__
+#define __BROADPHASE_H__
+
+#include <stdint.h>
+#include "body.h"
+
+/**
+ * The proxy of a body that has not been added to a persistent broadphase.
+ */
+#define NO_PROXY SIZE_MAX
+
+/**
+ * The algorithms a scene can use to find pairs of bodies that are close
+ * enough to be colliding, before running the exact (narrowphase) test.
+ */
+typedef enum {
+    /** A uniform grid that is rebuilt from scratch every tick */
+    BROADPHASE_SPATIAL_HASH,
+    /** Bounding box endpoints kept sorted along the x-axis across ticks */
+    BROADPHASE_SWEEP_AND_PRUNE,
+    /** A tree of padded boxes that only changes when a body leaves its box */
+    BROADPHASE_AABB_TREE
+} BroadphaseType;
+
+/**
+ * A function called with each pair of bodies whose bounding boxes overlap.
+ * Takes in an auxiliary value that can store parameters or state.
+ */
+typedef void (*PairCallback)(Body *body1, Body *body2, void *aux);
+
+/**
+ * A function called with each body found by a region query.
+ * Takes in an auxiliary value that can store parameters or state.
+ */
+typedef void (*BodyCallback)(Body *body, void *aux);
+
+#endif // #ifndef __BROADPHASE_H__
@@ -2,7 +2,9 @@
 #define __COLLISION_H__
 
 #include <stdbool.h>
+#include "body.h"
 #include "list.h"
+#include "polygon.h"
 #include "vector.h"
 #include "projection.h"
 #include "list.h"
@@ -20,10 +22,13 @@ typedef struct {
      * If the shapes are colliding, the axis they are colliding on.
      * This is a unit vector pointing from the first shape towards the second.
      * Normal impulses are applied along this axis.
-     * If collided is false, this value is undefined.
+     * If collided is false, find_body_collision() sets this to an axis
+     * that separates the shapes (or (0, 0) if it found none);
+     * for the other functions it is undefined.
      */
     Vector axis;
-    // overlap on the collision axis
+    // overlap on the collision axis;
+    // only filled in by find_body_collision() and the functions it uses
     double min_overlap;
 } CollisionInfo;
 
@@ -43,6 +48,119 @@ typedef struct {
  */
 CollisionInfo find_collision(List *shape1, List *shape2);
 
+/**
+ * Computes the status of the collision between two packed convex polygons.
+ * Gives the same result as find_collision() on the same vertices,
+ * but walks each shape's vertices as one contiguous array.
+ *
+ * @param shape1 the first shape
+ * @param shape2 the second shape
+ * @return whether the shapes are colliding, and if so, the collision axis.
+ */
+CollisionInfo find_collision_packed(Polygon *shape1, Polygon *shape2);
+
+/**
+ * Projects every vertex of a packed polygon onto an axis.
+ *
+ * @param shape the packed polygon
+ * @param axis the axis to project onto
+ * @return the smallest and largest projected values
+ */
+Projection get_projection_packed(Polygon *shape, Vector axis);
+
+/**
+ * Computes the status of the collision between two packed convex polygons,
+ * testing only the given axes instead of recomputing them from the edges.
+ *
+ * @param shape1 the first shape
+ * @param axes1 the distinct unit edge normals of shape1
+ * @param shape2 the second shape
+ * @param axes2 the distinct unit edge normals of shape2
+ * @return whether the shapes are colliding, and if so, the collision axis
+ */
+CollisionInfo find_collision_with_axes(Polygon *shape1, Polygon *axes1,
+    Polygon *shape2, Polygon *axes2);
+
+/**
+ * Computes the status of the collision between two circles.
+ *
+ * @param center1 the center of the first circle
+ * @param radius1 the radius of the first circle
+ * @param center2 the center of the second circle
+ * @param radius2 the radius of the second circle
+ * @return whether the circles are colliding, and if so, the collision axis
+ *   (the unit vector between their centers)
+ */
+CollisionInfo find_collision_circles(Vector center1, double radius1,
+    Vector center2, double radius2);
+
+/**
+ * Computes the status of the collision between a circle
+ * and a packed convex polygon.
+ * Tests the polygon's axes and the axis from the circle's center
+ * to the polygon's closest vertex.
+ *
+ * @param center the center of the circle
+ * @param radius the radius of the circle
+ * @param shape the polygon
+ * @param axes the distinct unit edge normals of shape
+ * @return whether the shapes are colliding, and if so, the collision axis
+ */
+CollisionInfo find_collision_circle_polygon(Vector center, double radius,
+    Polygon *shape, Polygon *axes);
+
+/**
+ * Computes the status of the collision between two oriented boxes,
+ * without looking at their vertices.
+ * Gives the same result as find_collision_with_axes() on the boxes'
+ * polygons, testing the axes in the same order.
+ *
+ * @param center1 the center of the first box
+ * @param half1 the half-width and half-height of the first box
+ * @param axes1 the first box's unit edge normals,
+ *   its rotated (-1, 0) and (0, -1) axes
+ * @param center2 the center of the second box
+ * @param half2 the half-width and half-height of the second box
+ * @param axes2 the second box's unit edge normals
+ * @return whether the boxes are colliding, and if so, the collision axis
+ */
+CollisionInfo find_collision_boxes(Vector center1, Vector half1,
+    const Vector *axes1, Vector center2, Vector half2, const Vector *axes2);
+
+/**
+ * Computes the status of the collision between two bodies,
+ * using their cached shapes and edge normals.
+ * Bodies whose bounding circles or bounding boxes are apart are rejected
+ * without looking at their vertices.
+ * Circular bodies are tested in closed form,
+ * and pairs of boxes with find_collision_boxes().
+ * Pairs of convex polygons with many vertices between them use
+ * find_collision_gjk(), and the rest use find_collision_with_axes().
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @return whether the bodies are colliding, and if so,
+ *   the collision axis and the depth of the overlap along it
+ */
+CollisionInfo find_body_collision(Body *body1, Body *body2);
+
+/**
+ * Same as find_body_collision(), but after checking the bodies' bounds,
+ * first tries an axis that separated them on an earlier call.
+ * Bodies that were apart on the last tick are usually still apart along
+ * the same axis, and checking that takes only one projection per body.
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param separating_axis the axis to try first, or (0, 0) to skip it;
+ *   updated to an axis separating the bodies, or (0, 0) if they collide.
+ *   It is left alone when the bounds alone show the bodies are apart,
+ *   so it keeps the more useful axis from the last full test.
+ * @return the same result as find_body_collision()
+ */
+CollisionInfo find_body_collision_cached(Body *body1, Body *body2,
+    Vector *separating_axis);
+
 
 
 
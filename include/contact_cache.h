@@ -0,0 +1,103 @@
+#ifndef __CONTACT_CACHE_H__
+#define __CONTACT_CACHE_H__
+
+#include <stddef.h>
+#include "body.h"
+#include "vector.h"
+
+/**
+ * A contact between two touching bodies, remembered from tick to tick
+ * for as long as they keep touching.
+ *
+ * @param body1      the first body.
+ * @param body2      the second body.
+ * @param normal     a unit vector pointing from body1 towards body2.
+ * @param depth      how far the bodies overlap along normal.
+ * @param elasticity the "coefficient of restitution" of the contact.
+ * @param impulse    the normal impulse the solver has built up pushing
+ *   the bodies apart; carried over so the next tick can start from it.
+ * @param ticks      the number of ticks in a row the bodies have touched,
+ *   so 1 on the tick they first touch.
+ */
+typedef struct {
+    BodyHandle body1;
+    BodyHandle body2;
+    Vector normal;
+    double depth;
+    double elasticity;
+    double impulse;
+    size_t ticks;
+} Contact;
+
+/**
+ * A hash map from pairs of bodies to the contacts between them,
+ * holding the contacts of the current tick and of the one before it.
+ * A contact added again on the next tick picks up where it left off;
+ * one that is not is forgotten.
+ *
+ * Pairs are ordered: the same two bodies in the other order
+ * are a different contact.
+ */
+typedef struct contact_cache ContactCache;
+
+/**
+ * Allocates memory for an empty contact cache.
+ * Asserts that the required memory was allocated.
+ *
+ * @return the new cache
+ */
+ContactCache *contact_cache_init(void);
+
+/**
+ * Releases the memory allocated for a contact cache.
+ *
+ * @param cache a pointer to a cache returned from contact_cache_init()
+ */
+void contact_cache_free(ContactCache *cache);
+
+/**
+ * Starts a new tick: the current contacts become the previous ones,
+ * and the contacts of the tick before are forgotten.
+ *
+ * @param cache a pointer to a cache returned from contact_cache_init()
+ */
+void contact_cache_next_tick(ContactCache *cache);
+
+/**
+ * Adds the contact between two bodies to the current tick, if it is not
+ * there already. If the bodies also touched on the previous tick,
+ * the contact keeps its impulse and its count of ticks goes up by one;
+ * otherwise it starts with no impulse and a count of 1.
+ * The caller fills in the normal, depth and elasticity.
+ *
+ * @param cache a pointer to a cache returned from contact_cache_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @return the contact, which stays valid until the next call to
+ *   contact_cache_add() or contact_cache_next_tick()
+ */
+Contact *contact_cache_add(
+    ContactCache *cache, BodyHandle body1, BodyHandle body2
+);
+
+/**
+ * Gets the number of contacts in the current tick.
+ *
+ * @param cache a pointer to a cache returned from contact_cache_init()
+ * @return the number of contacts added since the last
+ *   contact_cache_next_tick()
+ */
+size_t contact_cache_size(ContactCache *cache);
+
+/**
+ * Gets a contact of the current tick.
+ * Asserts that the index is valid.
+ *
+ * @param cache a pointer to a cache returned from contact_cache_init()
+ * @param index the index of the contact, in the order they were added
+ * @return the contact, which stays valid until the next call to
+ *   contact_cache_add() or contact_cache_next_tick()
+ */
+Contact *contact_cache_get(ContactCache *cache, size_t index);
+
+#endif // #ifndef __CONTACT_CACHE_H__
@@ -10,18 +10,7 @@
 #include "collision.h"
 #include "body.h"
 #include "shapes.h"
-
-
-/**
- * A function called when a collision occurs.
- * @param body1 the first body passed to create_collision()
- * @param body2 the second body passed to create_collision()
- * @param axis a unit vector pointing from body1 towards body2
- *   that defines the direction the two bodies are colliding in
- * @param aux the auxiliary value passed to create_collision()
- */
-typedef void (*CollisionHandler)
-    (Body *body1, Body *body2, Vector axis, void *aux);
+#include "barnes_hut.h"
 
 
 /**
@@ -37,6 +26,39 @@ typedef void (*CollisionHandler)
  */
 void create_newtonian_gravity(Scene *scene, double G, Body *body1, Body *body2);
 
+/**
+ * A Newtonian gravitational field between any number of bodies in a scene.
+ * Every tick, the field rebuilds a Barnes-Hut quadtree over its bodies
+ * (see barnes_hut.h), so it takes O(n log n) time instead of the O(n^2)
+ * of calling create_newtonian_gravity() on every pair of bodies.
+ * The field is owned by the scene and freed along with it.
+ */
+typedef struct gravity_field GravityField;
+
+/**
+ * Adds an empty gravitational field to a scene.
+ * Like create_newtonian_gravity(), the force between two bodies
+ * is not applied when they are very close.
+ *
+ * @param scene the scene to add the field to
+ * @param G the gravitational proportionality constant
+ * @param theta the opening angle, which trades accuracy for speed.
+ *   0 computes every pair exactly; 0.5 is a good default.
+ * @return the new field
+ */
+GravityField *create_gravity_field(Scene *scene, double G, double theta);
+
+/**
+ * Adds a body to a gravitational field, so that it attracts
+ * and is attracted by every other body in the field.
+ * The body is dropped from the field once it is freed.
+ * Asserts that the body's mass is finite.
+ *
+ * @param field a field returned from create_gravity_field()
+ * @param body the body to add
+ */
+void gravity_field_add_body(GravityField *field, Body *body);
+
 /**
  * Adds a Hooke's-Law spring force between two bodies in a scene.
  * See https://en.wikipedia.org/wiki/Hooke%27s_law.
@@ -68,6 +90,11 @@ void create_drag(Scene *scene, double gamma, Body *body);
  * The handler is passed the bodies, the collision axis, and an auxiliary value.
  * It should only be called once while the bodies are still colliding.
  *
+ * The force creator itself only queues a CollisionEvent each tick the
+ * bodies touch, plus one when they come apart (see
+ * scene_add_collision_event()); the scene calls the handler for the
+ * first event of each contact once every pair has been tested.
+ *
  * @param scene the scene containing the bodies
  * @param body1 the first body
  * @param body2 the second body
@@ -97,11 +124,25 @@ void create_collision(
 void create_destructive_collision(Scene *scene, Body *body1, Body *body2);
 void create_half_destructive_collision(Scene *scene, Body *body1, Body *body2);
 
+/**
+ * A CollisionHandler that applies a single impulse to resolve a collision.
+ * Unlike create_physics_collision(), it does nothing while the bodies
+ * stay in contact after the first tick.
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param axis the collision axis, pointing from body1 towards body2
+ * @param aux a pointer to the elasticity of the collision, a double
+ */
+void physics_collision_handler(Body *body1, Body *body2, Vector axis, void *aux);
+
 /**
  * Adds a ForceCreator to a scene that applies impulses
  * to resolve collisions between two bodies in the scene.
- * This should be represented as an on-collision callback
- * registered with create_collision().
+ * It queues the same collision events as create_collision(), without
+ * a handler, and hands each tick's contact to the scene's solver
+ * (see scene_add_contact()), which also keeps the bodies from sinking
+ * into each other while they stay in contact.
  *
  * You may remember from project01 that you should avoid applying impulses
  * multiple times while the bodies are still colliding.
@@ -118,5 +159,52 @@ void create_physics_collision(
     Scene *scene, double elasticity, Body *body1, Body *body2
 );
 
+/**
+ * Same as create_collision(), but between every body in category1
+ * and every body in category2, including ones added later.
+ * Registered once as a category response (see scene_add_category_response()),
+ * so it does not need to be called again for each new body.
+ *
+ * @param scene the scene containing the bodies
+ * @param category1 the categories of the first body passed to the handler
+ * @param category2 the categories of the second body passed to the handler
+ * @param handler a function to call whenever two such bodies collide
+ * @param aux an auxiliary value to pass to the handler
+ * @param freer if non-NULL, a function to call in order to free aux
+ */
+void create_category_collision(
+    Scene *scene,
+    uint32_t category1,
+    uint32_t category2,
+    CollisionHandler handler,
+    void *aux,
+    FreeFunc freer
+);
+
+/**
+ * Same as create_destructive_collision(), but between every body in
+ * category1 and every body in category2. See create_category_collision().
+ *
+ * @param scene the scene containing the bodies
+ * @param category1 the categories of the first body
+ * @param category2 the categories of the second body
+ */
+void create_category_destructive_collision(
+    Scene *scene, uint32_t category1, uint32_t category2
+);
+
+/**
+ * Same as create_physics_collision(), but between every body in
+ * category1 and every body in category2. See create_category_collision().
+ *
+ * @param scene the scene containing the bodies
+ * @param elasticity the "coefficient of restitution" of the collisions
+ * @param category1 the categories of the first body
+ * @param category2 the categories of the second body
+ */
+void create_category_physics_collision(
+    Scene *scene, double elasticity, uint32_t category1, uint32_t category2
+);
+
 
 #endif // #ifndef __FORCES_H__
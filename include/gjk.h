@@ -0,0 +1,35 @@
+#ifndef __GJK_H__
+#define __GJK_H__
+
+#include <stddef.h>
+#include "collision.h"
+#include "polygon.h"
+
+/**
+ * Finds the vertex of a convex polygon that is furthest along a direction,
+ * i.e. the polygon's support point in that direction.
+ * Walks from a starting vertex to whichever neighbor is further along,
+ * so starting near the answer (e.g. at the previous answer) makes this fast.
+ *
+ * @param shape a convex polygon with its vertices in order
+ * @param direction the direction to search in
+ * @param start the index of the vertex to start walking from
+ * @return the index of the furthest vertex
+ */
+size_t polygon_support(Polygon *shape, Vector direction, size_t start);
+
+/**
+ * Computes the status of the collision between two convex polygons
+ * using GJK, and the penetration depth using EPA.
+ * Each step only needs the shapes' support points, so the cost grows with
+ * the number of steps rather than with the product of the vertex counts,
+ * which makes this faster than SAT for shapes with many vertices.
+ *
+ * @param shape1 the first shape
+ * @param shape2 the second shape
+ * @return whether the shapes are colliding, and if so, the axis
+ *   (pointing from shape1 towards shape2) and depth of the penetration
+ */
+CollisionInfo find_collision_gjk(Polygon *shape1, Polygon *shape2);
+
+#endif // #ifndef __GJK_H__
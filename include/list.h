@@ -1,6 +1,7 @@
 #ifndef __LIST_H__
 #define __LIST_H__
 
+#include <stdbool.h>
 #include <stddef.h>
 
 /**
@@ -16,6 +17,11 @@ typedef struct list List;
  */
 typedef void (*FreeFunc)(void *data);
 
+/**
+ * A function that decides whether to remove an element in list_remove_if().
+ */
+typedef bool (*ListPredicate)(void *data, void *aux);
+
 /**
  * Allocates memory for a new list with space for the given number of elements.
  * The list is initially empty.
@@ -64,6 +70,30 @@ void *list_get(List *list, size_t index);
  */
 void *list_remove(List *list, size_t index);
 
+/**
+ * Removes the element at a given index in a list and returns it,
+ * moving the last element into its place.
+ * This takes constant time but does not preserve the order of the list.
+ * Asserts that the index is valid, given the list's current size.
+ *
+ * @param list a pointer to a list returned from list_init()
+ * @return the element at the given index in the list
+ */
+void *list_swap_remove(List *list, size_t index);
+
+/**
+ * Removes every element of a list for which a predicate returns true,
+ * in a single pass that keeps the remaining elements in order.
+ * The list's freer is not called; the predicate may release the elements
+ * it removes, but must not add to or remove from the list itself.
+ *
+ * @param list a pointer to a list returned from list_init()
+ * @param pred a function returning whether an element should be removed
+ * @param aux an auxiliary value passed to pred along with each element
+ * @return the number of elements removed
+ */
+size_t list_remove_if(List *list, ListPredicate pred, void *aux);
+
 /**
  * Appends an element to the end of a list.
  * If the list is filled to capacity, resizes the list to fit more elements
@@ -75,4 +105,12 @@ void *list_remove(List *list, size_t index);
  */
 void list_add(List *list, void *value);
 
+/**
+ * Removes all elements from a list, calling its freer (if any) on each one.
+ * The list keeps its capacity, so it can be refilled without reallocating.
+ *
+ * @param list a pointer to a list returned from list_init()
+ */
+void list_clear(List *list);
+
 #endif // #ifndef __LIST_H__
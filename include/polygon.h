@@ -1,9 +1,24 @@
 #ifndef __POLYGON_H__
 #define __POLYGON_H__
 
+#include <stdbool.h>
+#include <stddef.h>
 #include "list.h"
 #include "vector.h"
 
+/**
+ * A polygon whose vertices are stored inline, in one contiguous array.
+ * Unlike a list of Vector pointers, a packed polygon takes a single
+ * allocation and its vertices can be walked without chasing pointers.
+ * The vertices are listed in a counterclockwise direction.
+ */
+typedef struct {
+    /** The number of vertices */
+    size_t size;
+    /** The vertices themselves */
+    Vector vertices[];
+} Polygon;
+
 /**
  * Computes the area of a polygon.
  * See https://en.wikipedia.org/wiki/Shoelace_formula#Statement.
@@ -46,4 +61,82 @@ void polygon_translate(List *polygon, Vector translation);
  */
 void polygon_rotate(List *polygon, double angle, Vector point);
 
+/**
+ * Allocates memory for a packed polygon with the given number of vertices.
+ * The vertices are initially all (0, 0).
+ * Asserts that the required memory is allocated.
+ *
+ * @param size the number of vertices
+ * @return a pointer to the new polygon
+ */
+Polygon *polygon_init(size_t size);
+
+/**
+ * Allocates a packed polygon holding the same vertices as a list.
+ *
+ * @param polygon the list of vertices to copy
+ * @return a pointer to the new polygon
+ */
+Polygon *polygon_from_list(List *polygon);
+
+/**
+ * Allocates a list of vectors holding the same vertices as a packed polygon.
+ * The list must be list_free()d.
+ *
+ * @param polygon the packed polygon to copy
+ * @return the new list of vertices
+ */
+List *polygon_to_list(Polygon *polygon);
+
+/**
+ * Releases the memory allocated for a packed polygon.
+ *
+ * @param polygon a pointer to a polygon returned from polygon_init()
+ */
+void polygon_free(Polygon *polygon);
+
+/**
+ * Computes the area of a packed polygon. See polygon_area().
+ */
+double polygon_area_packed(Polygon *polygon);
+
+/**
+ * Computes the center of mass of a packed polygon. See polygon_centroid().
+ */
+Vector polygon_centroid_packed(Polygon *polygon);
+
+/**
+ * Translates all vertices in a packed polygon by a given vector.
+ * See polygon_translate().
+ */
+void polygon_translate_packed(Polygon *polygon, Vector translation);
+
+/**
+ * Rotates vertices in a packed polygon by a given angle about a given point.
+ * See polygon_rotate().
+ */
+void polygon_rotate_packed(Polygon *polygon, double angle, Vector point);
+
+/**
+ * Computes the unit normals of a packed polygon's edges,
+ * which are the axes the separating axis test needs to check.
+ * Normals parallel to one already found (e.g. from the opposite side
+ * of a rectangle) are left out, since they would give the same result.
+ *
+ * @param polygon the packed polygon
+ * @return a new packed array holding the normals, to be freed with
+ *   polygon_free(); its size is the number of distinct normals
+ */
+Polygon *polygon_edge_normals(Polygon *polygon);
+
+/**
+ * Determines whether a packed polygon is convex,
+ * i.e. whether every corner turns the same way.
+ * Straight corners (three collinear vertices) are allowed.
+ *
+ * @param polygon the packed polygon
+ * @return whether the polygon is convex
+ */
+bool polygon_is_convex(Polygon *polygon);
+
 #endif // #ifndef __POLYGON_H__
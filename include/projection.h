@@ -2,6 +2,8 @@
 #define __PROJECTION_H__
 
 #include <stdbool.h>
+#include <stddef.h>
+#include "vector.h"
 #define MAX_(x, y) (((x) > (y)) ? (x) : (y))
 #define MIN_(x, y) (((x) < (y)) ? (x) : (y))
 
@@ -16,4 +18,27 @@ bool overlaps(Projection p1, Projection p2);
 
 // Gets overlap between given projections
 double getOverlap(Projection p1, Projection p2);
+
+// Projects count (at least 1) vertices onto an axis in one pass and returns
+// the smallest and largest values. Uses AVX2 or SSE2 when the CPU has them;
+// the implementation is picked on the first call.
+Projection project_vertices(const Vector *vertices, size_t count, Vector axis);
+
+// The plain C version of project_vertices(), used when SIMD is unavailable
+Projection project_vertices_scalar(const Vector *vertices, size_t count,
+    Vector axis);
+
+// The implementations project_vertices() picks from
+typedef enum {
+    PROJECTION_SCALAR,
+    PROJECTION_SSE2,
+    PROJECTION_AVX2
+} ProjectionKernelType;
+
+typedef Projection (*ProjectionKernel)(const Vector *vertices, size_t count,
+    Vector axis);
+
+// Gets one implementation of project_vertices(), e.g. to compare them.
+// Returns NULL if the build or the CPU does not support it.
+ProjectionKernel projection_get_kernel(ProjectionKernelType type);
 #endif // #ifndef __PROJECTION_H__
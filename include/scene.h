@@ -2,15 +2,24 @@
 #define __SCENE_H__
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <time.h>
 #include <SDL2/SDL_Mixer.h>
 
+#include "aabb_tree.h"
+#include "arena.h"
+#include "array.h"
 #include "body.h"
+#include "broadphase.h"
+#include "contact_cache.h"
 #include "list.h"
 #include "shapes.h"
+#include "spatial_hash.h"
+#include "sweep_prune.h"
+#include "thread_pool.h"
 
 /**
  * A collection of bodies and force creators.
@@ -26,6 +35,72 @@ typedef struct scene Scene;
  */
 typedef void (*ForceCreator)(void *aux);
 
+/**
+ * A narrowphase test for a pair force creator, e.g. checking whether
+ * its two bodies actually collide, which stores its result in the
+ * auxiliary value for the force creator to act on.
+ * Each tick, the scene runs the tests of all the pairs it found
+ * before invoking any of their force creators. Tests may run on worker threads
+ * (see scene_set_threads()), so a test must only read bodies and
+ * write to its own auxiliary value. Anything else, such as adding impulses,
+ * removing bodies or changing colors, belongs in the force creator,
+ * which the scene invokes on the calling thread in a fixed order.
+ */
+typedef void (*PairTest)(void *aux);
+
+/**
+ * A function called when a collision occurs.
+ * @param body1 the first body passed to create_collision()
+ * @param body2 the second body passed to create_collision()
+ * @param axis a unit vector pointing from body1 towards body2
+ *   that defines the direction the two bodies are colliding in
+ * @param aux the auxiliary value passed to create_collision()
+ */
+typedef void (*CollisionHandler)
+    (Body *body1, Body *body2, Vector axis, void *aux);
+
+/**
+ * Which tick of a contact between two bodies a collision event is from.
+ */
+typedef enum {
+    COLLISION_BEGIN,   // the first tick the bodies touch
+    COLLISION_PERSIST, // a later tick they are still touching
+    COLLISION_END      // the first tick they no longer touch
+} CollisionPhase;
+
+/**
+ * A contact between two bodies, found while running a tick's pair
+ * force creators and handled once all of them have run.
+ * See scene_add_collision_event().
+ *
+ * @param body1   the first body.
+ * @param body2   the second body.
+ * @param normal  a unit vector pointing from body1 towards body2,
+ *   or (0, 0) for COLLISION_END.
+ * @param depth   how far the bodies overlap along normal, or 0 if unknown.
+ * @param phase   which tick of the contact this is.
+ * @param handler if non-NULL, called with the bodies, normal and aux
+ *   when the event is handled, but only for COLLISION_BEGIN.
+ * @param aux     the auxiliary value to pass to handler.
+ */
+typedef struct {
+    BodyHandle body1;
+    BodyHandle body2;
+    Vector normal;
+    double depth;
+    CollisionPhase phase;
+    CollisionHandler handler;
+    void *aux;
+} CollisionEvent;
+
+/**
+ * A function which makes the auxiliary value for a pair force creator
+ * that a category response adds between two bodies.
+ * Takes in the two bodies, in the order of the response's categories,
+ * and the auxiliary value the response was registered with.
+ */
+typedef void *(*PairAuxInit)(Body *body1, Body *body2, void *aux);
+
 /**
  * Allocates memory for an empty scene.
  * Makes a reasonable guess of the number of bodies to allocate space for.
@@ -101,12 +176,254 @@ void scene_add_force_creator(
  * @param bodies the list of bodies affected by the force creator.
  *   The force creator will be removed if any of these bodies are removed.
  *   This list does not own the bodies, so its freer should be NULL.
+ *   The scene copies the bodies out of the list and then frees it.
  * @param freer if non-NULL, a function to call in order to free aux
  */
 void scene_add_bodies_force_creator(
     Scene *scene, ForceCreator forcer, void *aux, List *bodies, FreeFunc freer
 );
 
+/**
+ * Finds a force creator that was added with scene_add_bodies_force_creator()
+ * (or scene_add_force_creator()) and is still in the scene.
+ * Useful for a force creator that handles many bodies at once
+ * and should only be added to each scene once.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param forcer the force creator function to look for
+ * @return the auxiliary value of the first such force creator,
+ *   or NULL if there is none
+ */
+void *scene_find_force_creator(Scene *scene, ForceCreator forcer);
+
+/**
+ * Adds a force creator that only acts while two bodies are touching,
+ * e.g. a collision between them.
+ * Rather than being invoked every tick, it is invoked whenever the scene's
+ * broadphase finds that the bounding boxes of the two bodies overlap,
+ * plus once on the tick after they stop overlapping,
+ * so it can reset any state it keeps about the contact.
+ * Otherwise behaves like scene_add_bodies_force_creator().
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param forcer a force creator function
+ * @param aux an auxiliary value to pass to forcer when it is called
+ * @param bodies the list of the two bodies the force creator acts between.
+ *   The force creator will be removed if either of these bodies is removed.
+ *   This list does not own the bodies, so its freer should be NULL.
+ *   The scene copies the bodies out of the list and then frees it.
+ * @param freer if non-NULL, a function to call in order to free aux
+ */
+void scene_add_pair_force_creator(
+    Scene *scene, ForceCreator forcer, void *aux, List *bodies, FreeFunc freer
+);
+
+/**
+ * Adds a pair force creator whose expensive part is split out into a test.
+ * Whenever the force creator is about to be invoked, the test is run first.
+ * Otherwise behaves like scene_add_pair_force_creator().
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param forcer a force creator function
+ * @param test the narrowphase test to run before forcer
+ * @param aux an auxiliary value to pass to test and forcer
+ * @param bodies the list of the two bodies the force creator acts between,
+ *   as in scene_add_pair_force_creator()
+ * @param freer if non-NULL, a function to call in order to free aux
+ */
+void scene_add_tested_pair_force_creator(
+    Scene *scene, ForceCreator forcer, PairTest test, void *aux, List *bodies,
+    FreeFunc freer
+);
+
+/**
+ * Registers a response between two collision categories,
+ * e.g. a collision between every bullet and every wall.
+ * Whenever the broadphase finds a body in category1 near a body in category2
+ * (see body_set_category()), the scene adds a pair force creator between
+ * them, unless this response already has one.
+ * Its auxiliary value is made with aux_init.
+ * It then behaves like one from scene_add_pair_force_creator(),
+ * except that it is freed once it has been invoked after the bodies separate.
+ * So bodies can be added without registering anything for them,
+ * and the number of force creators follows the number of nearby pairs.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param category1 the first body of a pair must share a bit with this
+ * @param category2 the second body of a pair must share a bit with this
+ * @param forcer the force creator to add between each pair
+ * @param test if non-NULL, the narrowphase test to run before forcer,
+ *   as in scene_add_tested_pair_force_creator()
+ * @param aux_init a function to make the auxiliary value for each pair
+ * @param pair_freer if non-NULL, a function to free each pair's auxiliary value
+ * @param aux an auxiliary value to pass to aux_init
+ * @param freer if non-NULL, a function to call in order to free aux
+ *   when the scene is freed
+ */
+void scene_add_category_response(Scene *scene, uint32_t category1,
+    uint32_t category2, ForceCreator forcer, PairTest test,
+    PairAuxInit aux_init, FreeFunc pair_freer, void *aux, FreeFunc freer);
+
+/**
+ * Sets how many worker threads a scene's ticks share their work with
+ * (see scene_tick()). Scenes start out with none,
+ * running everything on the thread that calls scene_tick().
+ * Only work that splits into independent pieces is shared,
+ * such as pair tests (see PairTest) and moving the bodies.
+ * Force creators always run on the calling thread in the same order,
+ * so the results of a tick do not depend on the number of threads.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param threads the number of worker threads, or 0 for none
+ */
+void scene_set_threads(Scene *scene, size_t threads);
+
+/**
+ * Gets the thread pool a scene's ticks share their work with,
+ * so force creators can split up their own work the same way.
+ * Force creators run on the thread that calls scene_tick(),
+ * so they may start loops on the pool.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the scene's pool, or NULL if it has no threads
+ */
+ThreadPool *scene_get_thread_pool(Scene *scene);
+
+/**
+ * Chooses the algorithm the scene uses to find nearby pairs of bodies
+ * for its pair force creators. Scenes start out using a spatial hash.
+ * Sweep and prune suits scenes where most bodies are still or slow.
+ * The AABB tree suits a mix of fast and slow bodies,
+ * and also makes scene_query_region() logarithmic.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param type the broadphase to use from the next tick on
+ */
+void scene_set_broadphase(Scene *scene, BroadphaseType type);
+
+/**
+ * Finds the bodies whose bounding boxes overlap a region of the scene.
+ * Uses the AABB tree if it is the scene's broadphase,
+ * and otherwise checks every body.
+ * Returns a newly allocated list of bodies, which must be list_free()d.
+ * The list does not own the bodies.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param region the box to search
+ * @return the bodies overlapping the region
+ */
+List *scene_query_region(Scene *scene, AABB region);
+
+/**
+ * Sets the size of the grid cells the scene uses to find nearby bodies.
+ * This should be around the size of a typical body in the scene.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param cell_size the width and height of each grid cell
+ */
+void scene_set_grid_cell_size(Scene *scene, double cell_size);
+
+/**
+ * Gets the scene's arena for scratch memory that only lives for one frame.
+ * The arena is reset at the start of each call to scene_tick(),
+ * so force creators and collision handlers can allocate from it freely.
+ * Code that runs outside scene_tick() (e.g. rendering) should release
+ * what it allocates with arena_mark() and arena_release().
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the scene's frame arena
+ */
+Arena *scene_get_frame_arena(Scene *scene);
+
+/**
+ * Queues a collision event, usually from a pair force creator.
+ * Once all of a tick's pair force creators have run, the scene handles
+ * the tick's events in one pass, in the order they were queued.
+ * So force creators only record what they found, and everything that
+ * changes the game (handlers removing bodies, recoloring them, etc.)
+ * happens afterwards, in an order that does not depend on how
+ * the collisions were found.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param event the event to queue
+ */
+void scene_add_collision_event(Scene *scene, CollisionEvent event);
+
+/**
+ * Gets the number of collision events of the last tick.
+ * They stay available until the next tick, so game code can look at
+ * contacts that have no handler, e.g. to play a sound when one ends.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the number of events queued during the last call to scene_tick()
+ */
+size_t scene_collision_events(Scene *scene);
+
+/**
+ * Gets a collision event of the last tick.
+ * Asserts that the index is valid.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param index the index of the event, in the order they were queued
+ * @return the event
+ */
+CollisionEvent scene_get_collision_event(Scene *scene, size_t index);
+
+/**
+ * Adds a contact for the scene to resolve with impulses this tick,
+ * usually from the force creator of a physics collision.
+ * Once all of a tick's pair force creators have run, the scene solves
+ * the tick's contacts together, before handling the collision events.
+ *
+ * On the first tick two bodies touch, they bounce apart with the given
+ * elasticity. While they keep touching, the scene remembers the impulse
+ * it used to keep them from moving into each other and starts the next
+ * tick from it, so bodies resting or pushing against each other settle
+ * within a few passes instead of sinking in and bouncing back out.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param axis the collision axis; either direction works
+ * @param depth how far the bodies overlap along the axis
+ * @param elasticity the "coefficient of restitution" of the collision
+ */
+void scene_add_contact(
+    Scene *scene, Body *body1, Body *body2, Vector axis, double depth,
+    double elasticity
+);
+
+/**
+ * Sets how many passes the scene makes over the contacts that have
+ * lasted more than one tick. Each pass adjusts every contact's impulse
+ * given the others', so more passes resolve bodies touching several
+ * others (e.g. a tank wedged between walls) more accurately.
+ * Since each tick starts from the last tick's impulses,
+ * a few passes are usually enough.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param iterations the number of passes; 0 leaves lasting contacts alone
+ */
+void scene_set_contact_iterations(Scene *scene, size_t iterations);
+
+/**
+ * Gets the number of contacts the scene solved on the last tick.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return the number of contacts added during the last call to scene_tick()
+ */
+size_t scene_contacts(Scene *scene);
+
+/**
+ * Gets a contact the scene solved on the last tick.
+ * Asserts that the index is valid.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param index the index of the contact, in the order they were added
+ * @return the contact, including the impulse it ended the tick with
+ */
+Contact scene_get_contact(Scene *scene, size_t index);
+
 /**
  * Executes a tick of a given scene over a small time interval.
  * This requires executing all the force creators
@@ -114,6 +431,10 @@ void scene_add_bodies_force_creator(
  * If any bodies are marked for removal, they should be removed from the scene
  * and freed, along with any force creators acting on them.
  *
+ * The tick runs in phases: the force creators that act every tick,
+ * the broadphase, the pair tests, the pair force creators,
+ * moving the bodies, and finally freeing the removed ones.
+ *
  * @param scene a pointer to a scene returned from scene_init()
  * @param dt the time elapsed since the last tick, in seconds
  */
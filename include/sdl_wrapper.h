@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include "color.h"
 #include "list.h"
+#include "polygon.h"
 #include "scene.h"
 #include "vector.h"
 
@@ -68,6 +69,24 @@ void sdl_clear(void);
  */
 void sdl_draw_polygon(List *points, RGBColor color);
 
+/**
+ * Draws a packed polygon with the given color.
+ * See sdl_draw_polygon().
+ *
+ * @param polygon the packed polygon
+ * @param color the color used to fill in the polygon
+ */
+void sdl_draw_polygon_packed(Polygon *polygon, RGBColor color);
+
+/**
+ * Draws a filled circle with the given color.
+ *
+ * @param position the center of the circle, in scene coordinates
+ * @param radius the radius of the circle, in scene units
+ * @param color the color used to fill in the circle
+ */
+void sdl_draw_circle(Vector position, double radius, RGBColor color);
+
 /**
  * Displays the rendered frame on the SDL window.
  * Must be called after drawing the polygons in order to show them.
@@ -76,8 +95,11 @@ void sdl_show(void);
 
 /**
  * Draws all bodies in a scene.
- * This internally calls sdl_clear(), sdl_draw_polygon(), and sdl_show(),
+ * This internally calls sdl_clear(), draws each body's polygon
+ * (or circle, for circular bodies),
+ * and calls sdl_show(),
  * so those functions should not be called directly.
+ * The screen points are taken from the scene's frame arena.
  *
  * @param scene the scene to draw
  */
@@ -5,7 +5,7 @@
 #include "list.h"
 #include "body.h"
 
-/* This enumerates the different bodies */
+/* This enumerates the different bodies, stored as their tag */
 typedef enum {
     PLAYER,
     ENEMY,
@@ -24,10 +24,16 @@ typedef enum {
     EXPLOSION
 } BodyType;
 
-
-typedef struct {
-    BodyType b;
-} Body_info;
+/**
+ * Gets the collision category of a BodyType, which has a bit of its own.
+ * The functions below put the bodies they create in the category of their
+ * BodyType, so masks and category responses can refer to kinds of bodies.
+ * See body_set_category().
+ *
+ * @param bt BodyType of the bodies
+ * @return the category bit for bt
+ */
+uint32_t body_type_category(BodyType bt);
 
 /**
  * Creates and returns pointer to body of n sides
@@ -42,6 +48,20 @@ typedef struct {
 Body *n_polygon_shape(size_t num_sides, double radius, double mass,
     RGBColor color, Vector centroid, BodyType bt);
 
+/**
+ * Creates and returns a pointer to a circular body.
+ * Circles collide and draw in closed form, so they are much cheaper
+ * than an n_polygon_shape() with many sides.
+ *
+ * @param radius
+ * @param mass
+ * @param color
+ * @param centroid
+ * @param bt BodyType of body
+ */
+Body *circle_shape(double radius, double mass, RGBColor color,
+    Vector centroid, BodyType bt);
+
 /**
  * Creates and returns a pointer to star of n sides
  *
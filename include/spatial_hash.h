@@ -0,0 +1,75 @@
+#ifndef __SPATIAL_HASH_H__
+#define __SPATIAL_HASH_H__
+
+#include "aabb.h"
+#include "body.h"
+#include "broadphase.h"
+
+/**
+ * A uniform grid that bins bodies by their bounding boxes.
+ * Cells are hashed into a fixed number of buckets, so the grid is unbounded
+ * and only costs memory for the cells that actually contain bodies.
+ * The grid is meant to be cleared and refilled every tick.
+ */
+typedef struct spatial_hash SpatialHash;
+
+/**
+ * Allocates memory for an empty spatial hash.
+ * Asserts that the cell size is positive and that the memory is allocated.
+ *
+ * @param cell_size the width and height of each grid cell.
+ *   This should be around the size of a typical body;
+ *   much smaller and large bodies span many cells,
+ *   much larger and each cell holds many bodies that are not near each other.
+ * @return the new spatial hash
+ */
+SpatialHash *spatial_hash_init(double cell_size);
+
+/**
+ * Releases the memory allocated for a spatial hash.
+ * Does not free the bodies inserted into it.
+ *
+ * @param hash a pointer to a spatial hash returned from spatial_hash_init()
+ */
+void spatial_hash_free(SpatialHash *hash);
+
+/**
+ * Changes the cell size of a spatial hash.
+ * Also removes all bodies from it.
+ *
+ * @param hash a pointer to a spatial hash returned from spatial_hash_init()
+ * @param cell_size the new width and height of each grid cell
+ */
+void spatial_hash_set_cell_size(SpatialHash *hash, double cell_size);
+
+/**
+ * Removes all bodies from a spatial hash, keeping its memory for reuse.
+ *
+ * @param hash a pointer to a spatial hash returned from spatial_hash_init()
+ */
+void spatial_hash_clear(SpatialHash *hash);
+
+/**
+ * Adds a body to every cell that its bounding box covers.
+ *
+ * @param hash a pointer to a spatial hash returned from spatial_hash_init()
+ * @param body the body to add
+ * @param bounds the body's current bounding box
+ */
+void spatial_hash_insert(SpatialHash *hash, Body *body, AABB bounds);
+
+/**
+ * Calls a function on every pair of bodies in the spatial hash
+ * whose bounding boxes overlap.
+ * Each pair is reported once, even if the bodies share several cells.
+ * The body that was inserted first is passed as body1.
+ *
+ * @param hash a pointer to a spatial hash returned from spatial_hash_init()
+ * @param callback the function to call on each overlapping pair
+ * @param aux an auxiliary value to pass to callback
+ */
+void spatial_hash_find_pairs(
+    SpatialHash *hash, PairCallback callback, void *aux
+);
+
+#endif // #ifndef __SPATIAL_HASH_H__
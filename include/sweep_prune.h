@@ -0,0 +1,74 @@
+#ifndef __SWEEP_PRUNE_H__
+#define __SWEEP_PRUNE_H__
+
+#include <stddef.h>
+#include "aabb.h"
+#include "body.h"
+#include "broadphase.h"
+
+/**
+ * A sweep-and-prune broadphase.
+ * Keeps the left and right edges of every body's bounding box in a list
+ * sorted along the x-axis. Since bodies move only a little between ticks,
+ * the list is nearly sorted already and can be re-sorted by insertion
+ * in close to linear time, instead of being rebuilt every tick.
+ */
+typedef struct sweep_prune SweepAndPrune;
+
+/**
+ * Allocates memory for an empty sweep-and-prune broadphase.
+ * Asserts that the required memory is allocated.
+ *
+ * @return the new broadphase
+ */
+SweepAndPrune *sweep_prune_init(void);
+
+/**
+ * Releases the memory allocated for a sweep-and-prune broadphase.
+ * Does not free the bodies inserted into it.
+ *
+ * @param sap a pointer to a broadphase returned from sweep_prune_init()
+ */
+void sweep_prune_free(SweepAndPrune *sap);
+
+/**
+ * Adds a body to a sweep-and-prune broadphase.
+ *
+ * @param sap a pointer to a broadphase returned from sweep_prune_init()
+ * @param body the body to add
+ * @param bounds the body's current bounding box
+ * @return a proxy identifying the body in later calls
+ */
+size_t sweep_prune_insert(SweepAndPrune *sap, Body *body, AABB bounds);
+
+/**
+ * Removes a body from a sweep-and-prune broadphase.
+ * Its endpoints are dropped from the sorted list during the next sweep.
+ *
+ * @param sap a pointer to a broadphase returned from sweep_prune_init()
+ * @param proxy the proxy returned when the body was inserted
+ */
+void sweep_prune_remove(SweepAndPrune *sap, size_t proxy);
+
+/**
+ * Records a body's new bounding box after it has moved.
+ *
+ * @param sap a pointer to a broadphase returned from sweep_prune_init()
+ * @param proxy the proxy returned when the body was inserted
+ * @param bounds the body's current bounding box
+ */
+void sweep_prune_update(SweepAndPrune *sap, size_t proxy, AABB bounds);
+
+/**
+ * Re-sorts the endpoints and calls a function on every pair of bodies
+ * whose bounding boxes overlap. Each pair is reported once.
+ *
+ * @param sap a pointer to a broadphase returned from sweep_prune_init()
+ * @param callback the function to call on each overlapping pair
+ * @param aux an auxiliary value to pass to callback
+ */
+void sweep_prune_find_pairs(
+    SweepAndPrune *sap, PairCallback callback, void *aux
+);
+
+#endif // #ifndef __SWEEP_PRUNE_H__
@@ -0,0 +1,139 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include <stddef.h>
+
+/**
+ * A fixed set of worker threads that share work by stealing.
+ * Each thread keeps its own queue of jobs; it works through the newest of
+ * its own jobs first, and when it runs out it takes the oldest job
+ * from another thread's queue.
+ *
+ * Work is started with thread_pool_for() or thread_pool_run_graph(),
+ * which return once all of it has finished, so they behave like ordinary
+ * calls. The thread that starts the work helps run it, and both may be
+ * called again from inside a running job to split it up further.
+ * Outside of jobs, only one thread at a time may start work on a pool.
+ *
+ * Compiling with THREAD_POOL_SERIAL defined leaves out the worker threads,
+ * so every pool runs its work on the calling thread.
+ */
+typedef struct thread_pool ThreadPool;
+
+/**
+ * A function which runs the iterations [begin, end) of a parallel loop.
+ * Different ranges of the same loop may run at the same time
+ * on different threads.
+ */
+typedef void (*RangeFunc)(void *aux, size_t begin, size_t end);
+
+/**
+ * A function which runs one task of a task graph.
+ */
+typedef void (*TaskFunc)(void *aux);
+
+/**
+ * A set of tasks and the order they have to run in.
+ * Tasks that do not depend on each other may run at the same time.
+ * A graph can be run any number of times.
+ */
+typedef struct task_graph TaskGraph;
+
+/**
+ * Starts a pool of worker threads.
+ * Asserts that the threads were started and the memory was allocated.
+ *
+ * @param threads the number of worker threads, not counting the thread
+ *   that starts the work. With 0 (or in a THREAD_POOL_SERIAL build),
+ *   all work runs on the calling thread.
+ * @return a pointer to the new pool
+ */
+ThreadPool *thread_pool_init(size_t threads);
+
+/**
+ * Stops a pool's worker threads and releases its memory.
+ *
+ * @param pool a pointer to a pool returned from thread_pool_init()
+ */
+void thread_pool_free(ThreadPool *pool);
+
+/**
+ * Gets the number of worker threads in a pool.
+ *
+ * @param pool a pointer to a pool returned from thread_pool_init()
+ * @return the number of worker threads the pool started
+ */
+size_t thread_pool_threads(ThreadPool *pool);
+
+/**
+ * Runs the iterations [0, count) of a loop across a pool's threads,
+ * handing them out in chunks of grain iterations to whichever thread is free.
+ * Which thread runs an iteration is not deterministic,
+ * so each iteration should only write to its own outputs.
+ *
+ * @param pool a pointer to a pool returned from thread_pool_init()
+ * @param count the number of iterations
+ * @param grain the number of iterations to hand out at a time;
+ *   asserted to be positive. Loops of at most this many iterations
+ *   run entirely on the calling thread.
+ * @param func the function to run each chunk of iterations
+ * @param aux an auxiliary value to pass to func
+ */
+void thread_pool_for(
+    ThreadPool *pool, size_t count, size_t grain, RangeFunc func, void *aux
+);
+
+/**
+ * Allocates memory for an empty task graph.
+ * Asserts that the required memory was allocated.
+ *
+ * @return the new graph
+ */
+TaskGraph *task_graph_init(void);
+
+/**
+ * Releases the memory allocated for a task graph.
+ *
+ * @param graph a pointer to a graph returned from task_graph_init()
+ */
+void task_graph_free(TaskGraph *graph);
+
+/**
+ * Removes all tasks from a task graph.
+ *
+ * @param graph a pointer to a graph returned from task_graph_init()
+ */
+void task_graph_clear(TaskGraph *graph);
+
+/**
+ * Adds a task to a task graph.
+ *
+ * @param graph a pointer to a graph returned from task_graph_init()
+ * @param func the function to run for the task
+ * @param aux an auxiliary value to pass to func
+ * @return the task's index, counting from 0 since the last clear
+ */
+size_t task_graph_add(TaskGraph *graph, TaskFunc func, void *aux);
+
+/**
+ * Makes one task of a task graph wait for another to finish.
+ * A task can only wait for tasks added before it,
+ * which keeps the graph free of cycles.
+ *
+ * @param graph a pointer to a graph returned from task_graph_init()
+ * @param task the index of the task that waits
+ * @param dependency the index of the task to wait for;
+ *   asserted to be less than task
+ */
+void task_graph_depend(TaskGraph *graph, size_t task, size_t dependency);
+
+/**
+ * Runs every task of a task graph across a pool's threads,
+ * starting each task once all the tasks it waits for have finished.
+ *
+ * @param pool a pointer to a pool returned from thread_pool_init()
+ * @param graph a pointer to a graph returned from task_graph_init()
+ */
+void thread_pool_run_graph(ThreadPool *pool, TaskGraph *graph);
+
+#endif // #ifndef __THREAD_POOL_H__
@@ -0,0 +1,72 @@
+#include <assert.h>
+#include <math.h>
+#include "aabb.h"
+
+AABB aabb_from_polygon(List *polygon) {
+    assert(polygon != NULL && list_size(polygon) > 0);
+    Vector *first = (Vector *) list_get(polygon, 0);
+    AABB res = {.min = *first, .max = *first};
+
+    for (size_t i = 1; i < list_size(polygon); i++) {
+        Vector *tmp = (Vector *) list_get(polygon, i);
+
+        if (tmp->x < res.min.x) {
+            res.min.x = tmp->x;
+        } else if (tmp->x > res.max.x) {
+            res.max.x = tmp->x;
+        }
+
+        if (tmp->y < res.min.y) {
+            res.min.y = tmp->y;
+        } else if (tmp->y > res.max.y) {
+            res.max.y = tmp->y;
+        }
+    }
+
+    return res;
+}
+
+AABB aabb_from_polygon_packed(Polygon *polygon) {
+    assert(polygon != NULL && polygon->size > 0);
+    Vector *vertices = polygon->vertices;
+    AABB res = {.min = vertices[0], .max = vertices[0]};
+
+    for (size_t i = 1; i < polygon->size; i++) {
+        res.min.x = fmin(res.min.x, vertices[i].x);
+        res.min.y = fmin(res.min.y, vertices[i].y);
+        res.max.x = fmax(res.max.x, vertices[i].x);
+        res.max.y = fmax(res.max.y, vertices[i].y);
+    }
+
+    return res;
+}
+
+bool aabb_overlaps(AABB box1, AABB box2) {
+    return !(box1.min.x > box2.max.x || box1.max.x < box2.min.x ||
+        box1.min.y > box2.max.y || box1.max.y < box2.min.y);
+}
+
+bool aabb_contains(AABB outer, AABB inner) {
+    return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y &&
+        outer.max.x >= inner.max.x && outer.max.y >= inner.max.y;
+}
+
+AABB aabb_union(AABB box1, AABB box2) {
+    return (AABB) {
+        .min = {.x = fmin(box1.min.x, box2.min.x),
+            .y = fmin(box1.min.y, box2.min.y)},
+        .max = {.x = fmax(box1.max.x, box2.max.x),
+            .y = fmax(box1.max.y, box2.max.y)}
+    };
+}
+
+AABB aabb_expand(AABB box, double margin) {
+    return (AABB) {
+        .min = {.x = box.min.x - margin, .y = box.min.y - margin},
+        .max = {.x = box.max.x + margin, .y = box.max.y + margin}
+    };
+}
+
+double aabb_perimeter(AABB box) {
+    return 2 * ((box.max.x - box.min.x) + (box.max.y - box.min.y));
+}
@@ -0,0 +1,396 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "aabb_tree.h"
+
+#define INIT_SIZE 64
+#define INC_FACTOR 2
+#define NO_NODE SIZE_MAX
+#define FREE_HEIGHT -1
+
+/**
+ * A node of the tree. Leaves have no children and hold a body.
+ *
+ * @param fat    for leaves, the padded box of the body;
+ *   for internal nodes, the union of the children's boxes.
+ * @param tight  for leaves, the body's exact bounding box.
+ * @param body   for leaves, the body; NULL for internal nodes.
+ * @param parent the parent node, or the next free node if this one is free.
+ * @param child1 the first child, or NO_NODE for leaves.
+ * @param child2 the second child, or NO_NODE for leaves.
+ * @param height 0 for leaves, FREE_HEIGHT for free nodes,
+ *   otherwise one more than the taller child.
+ */
+typedef struct {
+    AABB fat;
+    AABB tight;
+    Body *body;
+    size_t parent;
+    size_t child1;
+    size_t child2;
+    int height;
+} tree_node;
+
+/**
+ * @param margin      the padding added to each leaf's box.
+ * @param nodes       all nodes, both in use and free.
+ * @param num_nodes   the number of node slots ever used.
+ * @param root        the root node, or NO_NODE if the tree is empty.
+ * @param free_node   the first free node, or NO_NODE.
+ * @param stack       scratch space for walking the tree without recursion.
+ */
+struct aabb_tree {
+    double margin;
+    tree_node *nodes;
+    size_t num_nodes;
+    size_t node_capacity;
+    size_t root;
+    size_t free_node;
+    size_t *stack;
+    size_t stack_capacity;
+};
+
+AABBTree *aabb_tree_init(double margin) {
+    assert(margin >= 0);
+    AABBTree *res = malloc(sizeof(AABBTree));
+    assert(res != NULL);
+    res->margin = margin;
+    res->nodes = malloc(INIT_SIZE * sizeof(tree_node));
+    res->stack = malloc(INIT_SIZE * sizeof(size_t));
+    assert(res->nodes != NULL && res->stack != NULL);
+    res->num_nodes = 0;
+    res->node_capacity = INIT_SIZE;
+    res->root = NO_NODE;
+    res->free_node = NO_NODE;
+    res->stack_capacity = INIT_SIZE;
+    return res;
+}
+
+void aabb_tree_free(AABBTree *tree) {
+    assert(tree != NULL);
+    free(tree->nodes);
+    free(tree->stack);
+    free(tree);
+}
+
+// Takes a free node, growing the node array if there is none.
+// Note that growing may move the nodes, invalidating pointers to them.
+size_t tree_allocate_node(AABBTree *tree) {
+    size_t res;
+
+    if (tree->free_node != NO_NODE) {
+        res = tree->free_node;
+        tree->free_node = tree->nodes[res].parent;
+    } else {
+        if (tree->num_nodes == tree->node_capacity) {
+            tree->node_capacity *= INC_FACTOR;
+            tree->nodes = realloc(tree->nodes,
+                tree->node_capacity * sizeof(tree_node));
+            assert(tree->nodes != NULL);
+        }
+        res = tree->num_nodes++;
+    }
+
+    tree->nodes[res] = (tree_node) {.body = NULL, .parent = NO_NODE,
+        .child1 = NO_NODE, .child2 = NO_NODE, .height = 0};
+    return res;
+}
+
+void tree_free_node(AABBTree *tree, size_t node) {
+    tree->nodes[node].height = FREE_HEIGHT;
+    tree->nodes[node].body = NULL;
+    tree->nodes[node].parent = tree->free_node;
+    tree->free_node = node;
+}
+
+void tree_push(AABBTree *tree, size_t *size, size_t node) {
+    if (*size == tree->stack_capacity) {
+        tree->stack_capacity *= INC_FACTOR;
+        tree->stack = realloc(tree->stack,
+            tree->stack_capacity * sizeof(size_t));
+        assert(tree->stack != NULL);
+    }
+
+    tree->stack[(*size)++] = node;
+}
+
+// Points the parent of old_child (or the root) at new_child instead
+void tree_replace_child(AABBTree *tree, size_t parent, size_t old_child,
+    size_t new_child) {
+    if (parent == NO_NODE) {
+        tree->root = new_child;
+    } else if (tree->nodes[parent].child1 == old_child) {
+        tree->nodes[parent].child1 = new_child;
+    } else {
+        tree->nodes[parent].child2 = new_child;
+    }
+}
+
+int tree_max_height(int h1, int h2) {
+    return h1 > h2 ? h1 : h2;
+}
+
+/**
+ * If one child of node a is more than one level taller than the other,
+ * rotates the taller child up to take a's place.
+ * Returns the node now at a's old position.
+ */
+size_t tree_balance(AABBTree *tree, size_t ia) {
+    tree_node *nodes = tree->nodes;
+    tree_node *a = &nodes[ia];
+
+    if (a->height < 2) {
+        return ia;
+    }
+
+    size_t ib = a->child1;
+    size_t ic = a->child2;
+    tree_node *b = &nodes[ib];
+    tree_node *c = &nodes[ic];
+    int balance = c->height - b->height;
+
+    if (balance > 1) {
+        // Rotate c up; a keeps b and the shorter of c's children
+        size_t i_f = c->child1;
+        size_t i_g = c->child2;
+        tree_node *f = &nodes[i_f];
+        tree_node *g = &nodes[i_g];
+        c->child1 = ia;
+        c->parent = a->parent;
+        a->parent = ic;
+        tree_replace_child(tree, c->parent, ia, ic);
+
+        if (f->height > g->height) {
+            c->child2 = i_f;
+            a->child2 = i_g;
+            g->parent = ia;
+            a->fat = aabb_union(b->fat, g->fat);
+            c->fat = aabb_union(a->fat, f->fat);
+            a->height = 1 + tree_max_height(b->height, g->height);
+            c->height = 1 + tree_max_height(a->height, f->height);
+        } else {
+            c->child2 = i_g;
+            a->child2 = i_f;
+            f->parent = ia;
+            a->fat = aabb_union(b->fat, f->fat);
+            c->fat = aabb_union(a->fat, g->fat);
+            a->height = 1 + tree_max_height(b->height, f->height);
+            c->height = 1 + tree_max_height(a->height, g->height);
+        }
+
+        return ic;
+    }
+
+    if (balance < -1) {
+        // Rotate b up; a keeps c and the shorter of b's children
+        size_t id = b->child1;
+        size_t ie = b->child2;
+        tree_node *d = &nodes[id];
+        tree_node *e = &nodes[ie];
+        b->child1 = ia;
+        b->parent = a->parent;
+        a->parent = ib;
+        tree_replace_child(tree, b->parent, ia, ib);
+
+        if (d->height > e->height) {
+            b->child2 = id;
+            a->child1 = ie;
+            e->parent = ia;
+            a->fat = aabb_union(c->fat, e->fat);
+            b->fat = aabb_union(a->fat, d->fat);
+            a->height = 1 + tree_max_height(c->height, e->height);
+            b->height = 1 + tree_max_height(a->height, d->height);
+        } else {
+            b->child2 = ie;
+            a->child1 = id;
+            d->parent = ia;
+            a->fat = aabb_union(c->fat, d->fat);
+            b->fat = aabb_union(a->fat, e->fat);
+            a->height = 1 + tree_max_height(c->height, d->height);
+            b->height = 1 + tree_max_height(a->height, e->height);
+        }
+
+        return ib;
+    }
+
+    return ia;
+}
+
+// Rebalances and refits every ancestor from a node up to the root
+void tree_refit(AABBTree *tree, size_t node) {
+    while (node != NO_NODE) {
+        node = tree_balance(tree, node);
+        tree_node *tmp = &tree->nodes[node];
+        tree_node *child1 = &tree->nodes[tmp->child1];
+        tree_node *child2 = &tree->nodes[tmp->child2];
+        tmp->height = 1 + tree_max_height(child1->height, child2->height);
+        tmp->fat = aabb_union(child1->fat, child2->fat);
+        node = tmp->parent;
+    }
+}
+
+// Returns how much the tree's total perimeter grows if box joins a subtree
+double tree_descend_cost(tree_node *node, AABB box, double inheritance) {
+    double cost = aabb_perimeter(aabb_union(box, node->fat)) + inheritance;
+    return node->height == 0 ? cost : cost - aabb_perimeter(node->fat);
+}
+
+/**
+ * Inserts a leaf next to the sibling that least increases the total
+ * perimeter of the tree, descending greedily from the root.
+ */
+void tree_insert_leaf(AABBTree *tree, size_t leaf) {
+    if (tree->root == NO_NODE) {
+        tree->root = leaf;
+        tree->nodes[leaf].parent = NO_NODE;
+        return;
+    }
+
+    AABB box = tree->nodes[leaf].fat;
+    size_t index = tree->root;
+
+    while (tree->nodes[index].height > 0) {
+        tree_node *node = &tree->nodes[index];
+        double perimeter = aabb_perimeter(node->fat);
+        double combined = aabb_perimeter(aabb_union(node->fat, box));
+
+        // Cost of making a new parent for this node and the leaf, versus
+        // the cost of pushing the leaf further down into either child
+        double cost = 2 * combined;
+        double inheritance = 2 * (combined - perimeter);
+        double cost1 = tree_descend_cost(&tree->nodes[node->child1], box,
+            inheritance);
+        double cost2 = tree_descend_cost(&tree->nodes[node->child2], box,
+            inheritance);
+
+        if (cost < cost1 && cost < cost2) {
+            break;
+        }
+        index = cost1 < cost2 ? node->child1 : node->child2;
+    }
+
+    size_t sibling = index;
+    size_t new_parent = tree_allocate_node(tree);
+    tree_node *parent = &tree->nodes[new_parent];
+    parent->parent = tree->nodes[sibling].parent;
+    parent->fat = aabb_union(box, tree->nodes[sibling].fat);
+    parent->height = tree->nodes[sibling].height + 1;
+    parent->child1 = sibling;
+    parent->child2 = leaf;
+    tree_replace_child(tree, parent->parent, sibling, new_parent);
+    tree->nodes[sibling].parent = new_parent;
+    tree->nodes[leaf].parent = new_parent;
+
+    tree_refit(tree, parent->parent);
+}
+
+// Detaches a leaf, replacing its parent with its sibling
+void tree_remove_leaf(AABBTree *tree, size_t leaf) {
+    if (leaf == tree->root) {
+        tree->root = NO_NODE;
+        return;
+    }
+
+    size_t parent = tree->nodes[leaf].parent;
+    size_t grandparent = tree->nodes[parent].parent;
+    size_t sibling = tree->nodes[parent].child1 == leaf
+        ? tree->nodes[parent].child2 : tree->nodes[parent].child1;
+
+    tree_replace_child(tree, grandparent, parent, sibling);
+    tree->nodes[sibling].parent = grandparent;
+    tree_free_node(tree, parent);
+    tree_refit(tree, grandparent);
+}
+
+size_t aabb_tree_insert(AABBTree *tree, Body *body, AABB bounds) {
+    assert(tree != NULL && body != NULL);
+    size_t leaf = tree_allocate_node(tree);
+    tree->nodes[leaf].body = body;
+    tree->nodes[leaf].tight = bounds;
+    tree->nodes[leaf].fat = aabb_expand(bounds, tree->margin);
+    tree_insert_leaf(tree, leaf);
+    return leaf;
+}
+
+void aabb_tree_remove(AABBTree *tree, size_t proxy) {
+    assert(tree != NULL && proxy < tree->num_nodes);
+    assert(tree->nodes[proxy].height == 0);
+    tree_remove_leaf(tree, proxy);
+    tree_free_node(tree, proxy);
+}
+
+bool aabb_tree_update(AABBTree *tree, size_t proxy, AABB bounds) {
+    assert(tree != NULL && proxy < tree->num_nodes);
+    tree_node *leaf = &tree->nodes[proxy];
+    assert(leaf->height == 0);
+    leaf->tight = bounds;
+
+    if (aabb_contains(leaf->fat, bounds)) {
+        return false;
+    }
+
+    tree_remove_leaf(tree, proxy);
+    tree->nodes[proxy].fat = aabb_expand(bounds, tree->margin);
+    tree_insert_leaf(tree, proxy);
+    return true;
+}
+
+void aabb_tree_query(
+    AABBTree *tree, AABB region, BodyCallback callback, void *aux
+) {
+    assert(tree != NULL && callback != NULL);
+    size_t size = 0;
+
+    if (tree->root != NO_NODE) {
+        tree_push(tree, &size, tree->root);
+    }
+
+    while (size > 0) {
+        tree_node *node = &tree->nodes[tree->stack[--size]];
+
+        if (!aabb_overlaps(node->fat, region)) {
+            continue;
+        }
+
+        if (node->height == 0) {
+            if (aabb_overlaps(node->tight, region)) {
+                callback(node->body, aux);
+            }
+        } else {
+            tree_push(tree, &size, node->child1);
+            tree_push(tree, &size, node->child2);
+        }
+    }
+}
+
+void aabb_tree_find_pairs(AABBTree *tree, PairCallback callback, void *aux) {
+    assert(tree != NULL && callback != NULL);
+
+    for (size_t leaf = 0; leaf < tree->num_nodes; leaf++) {
+        if (tree->nodes[leaf].height != 0) {
+            continue;
+        }
+
+        // Only leaves with a larger index are reported, so that each pair
+        // is found from one side only
+        AABB bounds = tree->nodes[leaf].tight;
+        size_t size = 0;
+        tree_push(tree, &size, tree->root);
+
+        while (size > 0) {
+            size_t index = tree->stack[--size];
+            tree_node *node = &tree->nodes[index];
+
+            if (!aabb_overlaps(node->fat, bounds)) {
+                continue;
+            }
+
+            if (node->height > 0) {
+                tree_push(tree, &size, node->child1);
+                tree_push(tree, &size, node->child2);
+            } else if (index > leaf && aabb_overlaps(node->tight, bounds)) {
+                callback(tree->nodes[leaf].body, node->body, aux);
+            }
+        }
+    }
+}
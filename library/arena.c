@@ -0,0 +1,96 @@
+#include <assert.h>
+#include <stdalign.h>
+#include <stdlib.h>
+#include "arena.h"
+
+#define ALIGNMENT alignof(max_align_t)
+
+/**
+ * A block of memory allocated when the main block of an arena was full.
+ * The memory handed out follows the header.
+ */
+typedef struct overflow_block {
+    struct overflow_block *next;
+    alignas(max_align_t) char data[];
+} overflow_block;
+
+struct arena {
+    char *data;
+    size_t capacity;
+    size_t used;
+    overflow_block *overflow;
+    size_t overflow_bytes;
+};
+
+Arena *arena_init(size_t capacity) {
+    Arena *res = malloc(sizeof(Arena));
+    assert(res != NULL);
+    capacity = capacity == 0 ? ALIGNMENT : capacity;
+    res->data = malloc(capacity);
+    assert(res->data != NULL);
+    res->capacity = capacity;
+    res->used = 0;
+    res->overflow = NULL;
+    res->overflow_bytes = 0;
+    return res;
+}
+
+// Frees the overflow blocks of an arena
+void free_overflow(Arena *arena) {
+    while (arena->overflow != NULL) {
+        overflow_block *next = arena->overflow->next;
+        free(arena->overflow);
+        arena->overflow = next;
+    }
+}
+
+void arena_free(Arena *arena) {
+    assert(arena != NULL);
+    free_overflow(arena);
+    free(arena->data);
+    free(arena);
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    assert(arena != NULL);
+    size = (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+    if (size <= arena->capacity - arena->used) {
+        void *res = arena->data + arena->used;
+        arena->used += size;
+        return res;
+    }
+
+    overflow_block *block = malloc(sizeof(overflow_block) + size);
+    assert(block != NULL);
+    block->next = arena->overflow;
+    arena->overflow = block;
+    arena->overflow_bytes += size;
+    return block->data;
+}
+
+size_t arena_mark(Arena *arena) {
+    assert(arena != NULL);
+    return arena->used;
+}
+
+void arena_release(Arena *arena, size_t mark) {
+    assert(arena != NULL && mark <= arena->used);
+    arena->used = mark;
+}
+
+void arena_reset(Arena *arena) {
+    assert(arena != NULL);
+    arena->used = 0;
+
+    if (arena->overflow == NULL) {
+        return;
+    }
+
+    free_overflow(arena);
+    arena->capacity += arena->overflow_bytes;
+    arena->overflow_bytes = 0;
+    free(arena->data);
+    arena->data = malloc(arena->capacity);
+    assert(arena->data != NULL);
+}
@@ -0,0 +1,264 @@
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "array.h"
+#include "barnes_hut.h"
+
+#define INIT_SIZE 64
+#define NO_NODE SIZE_MAX
+#define QUADRANTS 4
+// Points at the same position can never be separated,
+// so a cell stops splitting after this many levels
+#define MAX_DEPTH 32
+// Walking the tree pops one cell and pushes at most four per level
+#define MAX_STACK (MAX_DEPTH * (QUADRANTS - 1) + QUADRANTS)
+
+typedef struct {
+    Vector position;
+    double mass;
+} quad_point;
+
+/**
+ * A square cell of the tree. Its points are order[begin..end).
+ *
+ * @param center         the center of the cell.
+ * @param half_width     half the width of the cell.
+ * @param mass           the total mass of the cell's points.
+ * @param center_of_mass the center of mass of the cell's points.
+ * @param first_child    the first of the cell's four consecutive children,
+ *   or NO_NODE for leaves.
+ */
+typedef struct {
+    Vector center;
+    double half_width;
+    double mass;
+    Vector center_of_mass;
+    size_t first_child;
+    size_t begin;
+    size_t end;
+} quad_node;
+
+ARRAY_DEFINE(QuadPointArray, quad_point, quad_point_array)
+ARRAY_DEFINE(QuadNodeArray, quad_node, quad_node_array)
+ARRAY_DEFINE(QuadIndexArray, size_t, quad_index_array)
+
+/**
+ * @param points  the points added since the last clear.
+ * @param nodes   the cells; the root is nodes[0].
+ * @param order   the indices of the points, ordered so that the points
+ *   of every cell are contiguous.
+ * @param scratch scratch space for partitioning order.
+ */
+struct barnes_hut {
+    QuadPointArray points;
+    QuadNodeArray nodes;
+    QuadIndexArray order;
+    QuadIndexArray scratch;
+};
+
+BarnesHut *barnes_hut_init(void) {
+    BarnesHut *res = malloc(sizeof(BarnesHut));
+    assert(res != NULL);
+    quad_point_array_init(&res->points, INIT_SIZE);
+    quad_node_array_init(&res->nodes, INIT_SIZE);
+    quad_index_array_init(&res->order, INIT_SIZE);
+    quad_index_array_init(&res->scratch, INIT_SIZE);
+    return res;
+}
+
+void barnes_hut_free(BarnesHut *tree) {
+    assert(tree != NULL);
+    quad_point_array_free(&tree->points);
+    quad_node_array_free(&tree->nodes);
+    quad_index_array_free(&tree->order);
+    quad_index_array_free(&tree->scratch);
+    free(tree);
+}
+
+void barnes_hut_clear(BarnesHut *tree) {
+    assert(tree != NULL);
+    quad_point_array_clear(&tree->points);
+    quad_node_array_clear(&tree->nodes);
+    quad_index_array_clear(&tree->order);
+}
+
+size_t barnes_hut_add(BarnesHut *tree, Vector position, double mass) {
+    assert(tree != NULL && isfinite(mass) && mass >= 0);
+    quad_point_array_add(&tree->points,
+        (quad_point) {.position = position, .mass = mass});
+    return tree->points.size - 1;
+}
+
+// Which of a cell's children a position falls in
+size_t quad_child(quad_node *node, Vector position) {
+    return (position.x >= node->center.x)
+        | (position.y >= node->center.y) << 1;
+}
+
+/**
+ * Fills in a cell's mass and center of mass, then splits its points
+ * among four children and recurses until each leaf has at most one point.
+ */
+void quad_build(BarnesHut *tree, size_t index, int depth) {
+    // Copied, since adding the children may move the nodes
+    quad_node node = ARRAY_AT(&tree->nodes, index);
+    Vector weighted = VEC_ZERO;
+    node.mass = 0;
+
+    for (size_t i = node.begin; i < node.end; i++) {
+        quad_point point = ARRAY_AT(&tree->points, ARRAY_AT(&tree->order, i));
+        node.mass += point.mass;
+        weighted = vec_add(weighted, vec_multiply(point.mass, point.position));
+    }
+    node.center_of_mass = node.mass > 0
+        ? vec_multiply(1 / node.mass, weighted) : node.center;
+
+    if (node.end - node.begin <= 1 || depth == MAX_DEPTH) {
+        ARRAY_AT(&tree->nodes, index) = node;
+        return;
+    }
+
+    // Counting sort of the cell's points by child
+    size_t starts[QUADRANTS + 1] = {0};
+    for (size_t i = node.begin; i < node.end; i++) {
+        quad_point point = ARRAY_AT(&tree->points, ARRAY_AT(&tree->order, i));
+        starts[quad_child(&node, point.position) + 1]++;
+    }
+    for (size_t q = 0; q < QUADRANTS; q++) {
+        starts[q + 1] += starts[q];
+    }
+
+    size_t next[QUADRANTS];
+    for (size_t q = 0; q < QUADRANTS; q++) {
+        next[q] = starts[q];
+    }
+    for (size_t i = node.begin; i < node.end; i++) {
+        size_t point = ARRAY_AT(&tree->order, i);
+        size_t q = quad_child(&node, ARRAY_AT(&tree->points, point).position);
+        ARRAY_AT(&tree->scratch, next[q]++) = point;
+    }
+    for (size_t i = node.begin; i < node.end; i++) {
+        ARRAY_AT(&tree->order, i) = ARRAY_AT(&tree->scratch, i - node.begin);
+    }
+
+    node.first_child = tree->nodes.size;
+    ARRAY_AT(&tree->nodes, index) = node;
+
+    double quarter = node.half_width / 2;
+    for (size_t q = 0; q < QUADRANTS; q++) {
+        Vector offset = {.x = q & 1 ? quarter : -quarter,
+            .y = q & 2 ? quarter : -quarter};
+        quad_node_array_add(&tree->nodes, (quad_node) {
+            .center = vec_add(node.center, offset),
+            .half_width = quarter,
+            .first_child = NO_NODE,
+            .begin = node.begin + starts[q],
+            .end = node.begin + starts[q + 1]});
+    }
+    for (size_t q = 0; q < QUADRANTS; q++) {
+        quad_build(tree, node.first_child + q, depth + 1);
+    }
+}
+
+void barnes_hut_build(BarnesHut *tree) {
+    assert(tree != NULL);
+    size_t count = tree->points.size;
+    quad_node_array_clear(&tree->nodes);
+    quad_index_array_clear(&tree->order);
+    if (count == 0) {
+        return;
+    }
+
+    quad_index_array_reserve(&tree->order, count);
+    quad_index_array_reserve(&tree->scratch, count);
+    Vector min = ARRAY_AT(&tree->points, 0).position;
+    Vector max = min;
+    for (size_t i = 0; i < count; i++) {
+        Vector position = ARRAY_AT(&tree->points, i).position;
+        min.x = fmin(min.x, position.x);
+        min.y = fmin(min.y, position.y);
+        max.x = fmax(max.x, position.x);
+        max.y = fmax(max.y, position.y);
+        quad_index_array_add(&tree->order, i);
+    }
+
+    quad_node_array_add(&tree->nodes, (quad_node) {
+        .center = vec_multiply(0.5, vec_add(min, max)),
+        .half_width = fmax(max.x - min.x, max.y - min.y) / 2,
+        .first_child = NO_NODE,
+        .begin = 0,
+        .end = count});
+    quad_build(tree, 0, 0);
+}
+
+// The field of a single mass at a position, or 0 if it is too close
+Vector quad_pull(Vector position, Vector source, double mass,
+    double min_distance) {
+    Vector r = vec_subtract(source, position);
+    double distance_squared = vec_dot(r, r);
+    double distance = sqrt(distance_squared);
+
+    if (distance <= min_distance) {
+        return VEC_ZERO;
+    }
+    return vec_multiply(mass / (distance_squared * distance), r);
+}
+
+bool quad_contains(quad_node *node, Vector position) {
+    return fabs(position.x - node->center.x) <= node->half_width
+        && fabs(position.y - node->center.y) <= node->half_width;
+}
+
+Vector barnes_hut_field(
+    BarnesHut *tree, Vector position, double theta, double min_distance,
+    size_t skip
+) {
+    assert(tree != NULL && theta >= 0);
+    Vector res = VEC_ZERO;
+    if (tree->nodes.size == 0) {
+        return res;
+    }
+
+    // On the stack rather than in the tree, so queries can run in parallel
+    size_t stack[MAX_STACK];
+    size_t stack_size = 0;
+    stack[stack_size++] = 0;
+
+    while (stack_size > 0) {
+        size_t index = stack[--stack_size];
+        quad_node *node = &ARRAY_AT(&tree->nodes, index);
+        if (node->mass == 0) {
+            continue;
+        }
+
+        if (node->first_child == NO_NODE) {
+            for (size_t i = node->begin; i < node->end; i++) {
+                size_t point_index = ARRAY_AT(&tree->order, i);
+                if (point_index == skip) {
+                    continue;
+                }
+                quad_point point = ARRAY_AT(&tree->points, point_index);
+                res = vec_add(res, quad_pull(position, point.position,
+                    point.mass, min_distance));
+            }
+            continue;
+        }
+
+        // A cell of width s at distance d is far enough if s / d < theta
+        Vector r = vec_subtract(node->center_of_mass, position);
+        if (!quad_contains(node, position)
+            && 4 * node->half_width * node->half_width
+                < theta * theta * vec_dot(r, r)) {
+            res = vec_add(res, quad_pull(position, node->center_of_mass,
+                node->mass, min_distance));
+            continue;
+        }
+
+        for (size_t q = 0; q < QUADRANTS; q++) {
+            assert(stack_size < MAX_STACK);
+            stack[stack_size++] = node->first_child + q;
+        }
+    }
+    return res;
+}
@@ -1,97 +1,452 @@
+#include <stdint.h>
 #include "body.h"
+#include "broadphase.h"
+
+#define SLAB_SIZE 64
+#define INIT_SLABS 4
+#define INC_FACTOR 2
+// Number of vertices in the polygon outline of a circular body
+#define CIRCLE_POINTS 20
+// Number of rows per chunk when a batch tick is split across threads
+#define INTEGRATE_GRAIN 1024
+// Bits of the moved column
+#define MOVED_CENTROID 1
+#define MOVED_ANGLE 2
 
 struct body {
-    List *shape; // original shape...never gets modified
-    Vector centroid;
-    Vector velocity;
-    double mass;
+    Polygon *shape; // original shape...never gets modified
+    Polygon *world_shape; // shape at the current centroid and angle
+    ShapeType shape_type;
+    double radius; // radius of a SHAPE_CIRCLE body
+    Vector half_extents; // half-width and half-height of a SHAPE_BOX body
+    bool world_shape_dirty; // whether world_shape needs to be rebuilt
+    Polygon *axes; // distinct unit edge normals of shape
+    Polygon *world_axes; // axes rotated by the current angle
+    bool world_axes_dirty; // whether world_axes needs to be rebuilt
+    bool convex; // whether shape is convex
+    double bounding_radius; // distance from the centroid to the furthest vertex
+    AABB local_aabb; // bounding box of shape at the current angle
+    bool local_aabb_dirty; // whether local_aabb needs to be recomputed
     RGBColor color;
-    double angle; // absolute angle of the shape
-    Vector force;
-    Vector impulse;
     void *info;
     FreeFunc info_freer;
     bool is_removed;
     bool is_collided;
-    double rate;
     int num_collided;
+    size_t proxy;
+    int tag;
+    uint32_t category; // collision category bits, see body_set_category()
+    uint32_t mask; // categories this body may interact with
+    size_t world_capacity; // number of vertices world_shape has room for
+    size_t axes_capacity; // number of normals world_axes has room for
+    uint32_t index; // position of the body's slot in the pool
+    uint32_t generation; // incremented each time the slot is freed
+    Body *next_free; // next free slot, while this slot is free
 };
 
+/**
+ * The motion state of every slot in the pool, stored as one array per
+ * component so body_tick_batch() can stream through them.
+ * Each array has room for every slot, and a body's row is its slot index.
+ * The arrays never overlap, which the restrict qualifiers tell the compiler.
+ *
+ * @param centroid_x, centroid_y the body's position.
+ * @param velocity_x, velocity_y the body's velocity.
+ * @param force_x, force_y       the force accumulated this tick.
+ * @param impulse_x, impulse_y   the impulse accumulated this tick.
+ * @param mass                   the body's mass (may be INFINITY).
+ * @param angle                  the absolute angle of the shape.
+ * @param rate                   the rotation rate, in half-turns per second.
+ * @param moved                  MOVED_CENTROID and/or MOVED_ANGLE if the
+ *                               last batch tick changed the centroid
+ *                               or the angle.
+ * @param in_batch               whether the row is part of the current
+ *                               body_tick_batch(); scratch space.
+ */
+typedef struct {
+    double *restrict centroid_x;
+    double *restrict centroid_y;
+    double *restrict velocity_x;
+    double *restrict velocity_y;
+    double *restrict force_x;
+    double *restrict force_y;
+    double *restrict impulse_x;
+    double *restrict impulse_y;
+    double *restrict mass;
+    double *restrict angle;
+    double *restrict rate;
+    uint8_t *restrict moved;
+    uint8_t *restrict in_batch;
+} BodyColumns;
+
+BodyColumns columns;
+
+ARRAY_DEFINE(RowArray, uint32_t, row_array)
+
+/**
+ * Scratch space for the rows integrated by body_tick_batch().
+ * Kept between calls so batches do not allocate once it is big enough.
+ */
+RowArray batch_rows = {NULL, 0, 0};
+
+/**
+ * The pool bodies are allocated from.
+ * Bodies live in fixed-size slabs that are never moved or freed,
+ * so a Body* stays valid (but possibly reused) after body_free().
+ * Freed slots are kept in a LIFO free list, so the most recently freed
+ * (and most likely cached) slot is reused first.
+ *
+ * @param slabs      the allocated slabs, each holding SLAB_SIZE bodies.
+ * @param slab_count the number of allocated slabs.
+ * @param slab_cap   the number of slabs the slabs array has room for.
+ * @param free_list  the first free slot, or NULL if every slot is in use.
+ */
+Body **slabs = NULL;
+size_t slab_count = 0;
+size_t slab_cap = 0;
+Body *free_list = NULL;
+
+// Resizes one column of the motion state to hold the given number of rows
+double *grow_column(double *column, size_t rows) {
+    column = realloc(column, rows * sizeof(double));
+    assert(column != NULL);
+    return column;
+}
+
+// Allocates another slab and adds its slots to the free list
+void add_slab(void) {
+    if (slab_count == slab_cap) {
+        slab_cap = slab_cap == 0 ? INIT_SLABS : INC_FACTOR * slab_cap;
+        slabs = realloc(slabs, slab_cap * sizeof(Body *));
+        assert(slabs != NULL);
+    }
+
+    Body *slab = malloc(SLAB_SIZE * sizeof(Body));
+    assert(slab != NULL);
+    assert((slab_count + 1) * SLAB_SIZE <= UINT32_MAX);
+
+    // Link the slots so the lowest index is handed out first
+    for (size_t i = SLAB_SIZE; i-- > 0;) {
+        slab[i].index = slab_count * SLAB_SIZE + i;
+        slab[i].generation = 0;
+        slab[i].world_shape = NULL;
+        slab[i].world_capacity = 0;
+        slab[i].world_axes = NULL;
+        slab[i].axes_capacity = 0;
+        slab[i].next_free = free_list;
+        free_list = &slab[i];
+    }
+    slabs[slab_count++] = slab;
+
+    size_t rows = slab_count * SLAB_SIZE;
+    columns.centroid_x = grow_column(columns.centroid_x, rows);
+    columns.centroid_y = grow_column(columns.centroid_y, rows);
+    columns.velocity_x = grow_column(columns.velocity_x, rows);
+    columns.velocity_y = grow_column(columns.velocity_y, rows);
+    columns.force_x = grow_column(columns.force_x, rows);
+    columns.force_y = grow_column(columns.force_y, rows);
+    columns.impulse_x = grow_column(columns.impulse_x, rows);
+    columns.impulse_y = grow_column(columns.impulse_y, rows);
+    columns.mass = grow_column(columns.mass, rows);
+    columns.angle = grow_column(columns.angle, rows);
+    columns.rate = grow_column(columns.rate, rows);
+    columns.moved = realloc(columns.moved, rows);
+    columns.in_batch = realloc(columns.in_batch, rows);
+    assert(columns.moved != NULL && columns.in_batch != NULL);
+    for (size_t r = rows - SLAB_SIZE; r < rows; r++) {
+        columns.in_batch[r] = false;
+    }
+}
+
 Body *body_init(List *shape, double mass, RGBColor color) {
     return body_init_with_info(shape, mass, color, NULL, NULL);
 }
 
 Body *body_init_with_info(List *shape, double mass, RGBColor color, void *info,
     FreeFunc info_freer) {
+    assert(shape != NULL);
+    Polygon *packed = polygon_from_list(shape);
+    list_free(shape);
+    return body_init_with_polygon(packed, mass, color, info, info_freer);
+}
+
+Body *body_init_with_polygon(Polygon *shape, double mass, RGBColor color,
+    void *info, FreeFunc info_freer) {
     assert(shape != NULL && mass > 0);
-    Body *res = malloc(sizeof(Body));
-    assert(res != NULL);
-    res->centroid = polygon_centroid(shape);
+    if (free_list == NULL) {
+        add_slab();
+    }
+    Body *res = free_list;
+    free_list = res->next_free;
+    res->next_free = NULL;
+
+    size_t row = res->index;
+    Vector centroid = polygon_centroid_packed(shape);
+    columns.centroid_x[row] = centroid.x;
+    columns.centroid_y[row] = centroid.y;
     res->shape = shape;
-
-    for (size_t i = 0; i < list_size(shape); i++) {
-        Vector *tmp = list_get(shape, i);
-        Vector new_vec = vec_subtract(*tmp, res->centroid);
-        tmp->x = new_vec.x;
-        tmp->y = new_vec.y;
+    // Reuse the previous occupant's world shape if it is big enough
+    if (res->world_capacity < shape->size) {
+        polygon_free(res->world_shape);
+        res->world_shape = polygon_init(shape->size);
+        res->world_capacity = shape->size;
     }
+    res->world_shape->size = shape->size;
+    res->world_shape_dirty = true;
+    polygon_translate_packed(shape, vec_negate(centroid));
+
+    res->axes = polygon_edge_normals(shape);
+    if (res->axes_capacity < res->axes->size) {
+        polygon_free(res->world_axes);
+        res->world_axes = polygon_init(res->axes->size);
+        res->axes_capacity = res->axes->size;
+    }
+    res->world_axes->size = res->axes->size;
+    res->world_axes_dirty = true;
+    res->convex = polygon_is_convex(shape);
+    res->bounding_radius = 0;
+    for (size_t i = 0; i < shape->size; i++) {
+        double dist = vec_magnitude(shape->vertices[i]);
+        if (dist > res->bounding_radius) {
+            res->bounding_radius = dist;
+        }
+    }
+    res->local_aabb_dirty = true;
 
-    res->velocity = (Vector) {0, 0};
-    res->mass = mass;
+    columns.velocity_x[row] = 0;
+    columns.velocity_y[row] = 0;
+    columns.mass[row] = mass;
     res->color = color;
-    res->angle = 0;
-    res->force = (Vector) {0, 0};
-    res->impulse = (Vector) {0, 0};
+    columns.angle[row] = 0;
+    columns.force_x[row] = 0;
+    columns.force_y[row] = 0;
+    columns.impulse_x[row] = 0;
+    columns.impulse_y[row] = 0;
     res->info = info;
     res->info_freer = info_freer;
     res->is_removed = false;
     res->is_collided = false;
-    res->rate = 0.0;
+    columns.rate[row] = 0.0;
     res->num_collided = 0;
+    res->proxy = NO_PROXY;
+    res->tag = 0;
+    res->category = 0;
+    res->mask = ALL_CATEGORIES;
+    res->shape_type = SHAPE_POLYGON;
+    res->radius = 0;
+    res->half_extents = VEC_ZERO;
     // res->num_shot_bullets = 0;
     return res;
 }
 
+Body *body_init_box(double width, double height, double mass,
+    RGBColor color, void *info, FreeFunc info_freer) {
+    assert(width > 0 && height > 0);
+    double d_x = width / 2;
+    double d_y = height / 2;
+    Polygon *outline = polygon_init(4);
+    outline->vertices[0] = (Vector) {-d_x, d_y};
+    outline->vertices[1] = (Vector) {-d_x, -d_y};
+    outline->vertices[2] = (Vector) {d_x, -d_y};
+    outline->vertices[3] = (Vector) {d_x, d_y};
+
+    // The edge normals come out as (-1, 0) and (0, -1),
+    // which the box-box test in collision.c relies on
+    Body *res = body_init_with_polygon(outline, mass, color, info, info_freer);
+    res->shape_type = SHAPE_BOX;
+    res->half_extents = (Vector) {d_x, d_y};
+    return res;
+}
+
+Body *body_init_circle(double radius, double mass, RGBColor color,
+    void *info, FreeFunc info_freer) {
+    assert(radius > 0);
+    Polygon *outline = polygon_init(CIRCLE_POINTS);
+    for (size_t i = 0; i < CIRCLE_POINTS; i++) {
+        double theta = 2 * M_PI * i / CIRCLE_POINTS;
+        outline->vertices[i] = (Vector) {radius * cos(theta),
+            radius * sin(theta)};
+    }
+
+    Body *res = body_init_with_polygon(outline, mass, color, info, info_freer);
+    // The outline is symmetric, so its centroid is (up to rounding) the origin
+    body_set_centroid(res, VEC_ZERO);
+    res->shape_type = SHAPE_CIRCLE;
+    res->radius = radius;
+    res->bounding_radius = radius;
+    // Circles are tested in closed form, not against edge normals
+    res->axes->size = 0;
+    res->world_axes->size = 0;
+    return res;
+}
+
 void body_free(Body *body) {
-    assert(body != NULL);
-    list_free(body->shape);
+    assert(body != NULL && body->next_free == NULL);
+    polygon_free(body->shape);
+    body->shape = NULL;
+    polygon_free(body->axes);
+    body->axes = NULL;
 
     if (body->info_freer != NULL && body->info != NULL) {
         body->info_freer(body->info);
     }
 
-    free(body);
+    // Invalidates any handles to the body; the world buffers stay for reuse
+    body->generation++;
+    body->next_free = free_list;
+    free_list = body;
+}
+
+BodyHandle body_get_handle(Body *body) {
+    assert(body != NULL);
+    return (BodyHandle) {.index = body->index, .generation = body->generation};
+}
+
+Body *body_from_handle(BodyHandle handle) {
+    if (handle.index >= slab_count * SLAB_SIZE) {
+        return NULL;
+    }
+
+    Body *body = &slabs[handle.index / SLAB_SIZE][handle.index % SLAB_SIZE];
+    return body->generation == handle.generation ? body : NULL;
 }
 
 List *body_get_shape(Body *body) {
     assert(body != NULL);
-    size_t size = list_size(body->shape);
-    List *res = list_init(size, (FreeFunc) vec_free);
-    assert(res != NULL);
-    size_t i;
+    return polygon_to_list(body_borrow_polygon(body));
+}
+
+Polygon *body_borrow_polygon(Body *body) {
+    assert(body != NULL);
 
-    for (i = 0; i < size; i++) {
-        Vector *tmp = (Vector *) list_get(body->shape, i);
-        Vector new_vec = vec_add(vec_rotate(*tmp, body->angle), body->centroid);
-        list_add(res, vec_init(new_vec.x, new_vec.y));
+    if (body->world_shape_dirty) {
+        // One cos/sin per rebuild instead of two per vertex in vec_rotate()
+        size_t row = body->index;
+        double cos_angle = cos(columns.angle[row]);
+        double sin_angle = sin(columns.angle[row]);
+        double centroid_x = columns.centroid_x[row];
+        double centroid_y = columns.centroid_y[row];
+        Vector *local = body->shape->vertices;
+        Vector *world = body->world_shape->vertices;
+
+        for (size_t i = 0; i < body->shape->size; i++) {
+            world[i].x = local[i].x * cos_angle - local[i].y * sin_angle
+                + centroid_x;
+            world[i].y = local[i].x * sin_angle + local[i].y * cos_angle
+                + centroid_y;
+        }
+
+        body->world_shape_dirty = false;
     }
 
-    return res;
+    return body->world_shape;
+}
+
+Polygon *body_borrow_axes(Body *body) {
+    assert(body != NULL);
+
+    if (body->world_axes_dirty) {
+        double angle = columns.angle[body->index];
+        double cos_angle = cos(angle);
+        double sin_angle = sin(angle);
+        Vector *local = body->axes->vertices;
+        Vector *world = body->world_axes->vertices;
+
+        for (size_t i = 0; i < body->axes->size; i++) {
+            world[i].x = local[i].x * cos_angle - local[i].y * sin_angle;
+            world[i].y = local[i].x * sin_angle + local[i].y * cos_angle;
+        }
+
+        body->world_axes_dirty = false;
+    }
+
+    return body->world_axes;
+}
+
+ShapeType body_get_shape_type(Body *body) {
+    assert(body != NULL);
+    return body->shape_type;
+}
+
+double body_get_radius(Body *body) {
+    assert(body != NULL && body->shape_type == SHAPE_CIRCLE);
+    return body->radius;
+}
+
+bool body_is_convex(Body *body) {
+    assert(body != NULL);
+    return body->convex;
+}
+
+Vector body_get_half_extents(Body *body) {
+    assert(body != NULL && body->shape_type == SHAPE_BOX);
+    return body->half_extents;
+}
+
+double body_get_bounding_radius(Body *body) {
+    assert(body != NULL);
+    return body->bounding_radius;
+}
+
+AABB body_get_aabb(Body *body) {
+    assert(body != NULL);
+    Vector centroid = body_get_centroid(body);
+
+    if (body->shape_type == SHAPE_CIRCLE) {
+        Vector extent = {body->radius, body->radius};
+        return (AABB) {.min = vec_subtract(centroid, extent),
+            .max = vec_add(centroid, extent)};
+    }
+
+    // The box around the centroid only changes when the body rotates,
+    // so moving bodies do not need their world shape rebuilt
+    if (body->local_aabb_dirty) {
+        double angle = columns.angle[body->index];
+        double cos_angle = cos(angle);
+        double sin_angle = sin(angle);
+        Vector *local = body->shape->vertices;
+        AABB box = {.min = {INFINITY, INFINITY},
+            .max = {-INFINITY, -INFINITY}};
+
+        for (size_t i = 0; i < body->shape->size; i++) {
+            double x = local[i].x * cos_angle - local[i].y * sin_angle;
+            double y = local[i].x * sin_angle + local[i].y * cos_angle;
+            box.min.x = x < box.min.x ? x : box.min.x;
+            box.min.y = y < box.min.y ? y : box.min.y;
+            box.max.x = x > box.max.x ? x : box.max.x;
+            box.max.y = y > box.max.y ? y : box.max.y;
+        }
+
+        body->local_aabb = box;
+        body->local_aabb_dirty = false;
+    }
+
+    return (AABB) {.min = vec_add(body->local_aabb.min, centroid),
+        .max = vec_add(body->local_aabb.max, centroid)};
+}
+
+void body_refresh_caches(Body *body) {
+    assert(body != NULL);
+    body_borrow_polygon(body);
+    body_borrow_axes(body);
+    body_get_aabb(body);
 }
 
 Vector body_get_centroid(Body *body) {
     assert(body != NULL);
-    return body->centroid;
+    return (Vector) {columns.centroid_x[body->index],
+        columns.centroid_y[body->index]};
 }
 
 Vector body_get_velocity(Body *body) {
     assert(body != NULL);
-    return body->velocity;
+    return (Vector) {columns.velocity_x[body->index],
+        columns.velocity_y[body->index]};
 }
 
 double body_get_mass(Body *body) {
     assert(body != NULL);
-    return body->mass;
+    return columns.mass[body->index];
 }
 
 RGBColor body_get_color(Body *body) {
@@ -110,45 +465,125 @@ void *body_get_info(Body *body) {
 
 double body_get_angle(Body *body) {
     assert(body != NULL);
-    return body->angle;
+    return columns.angle[body->index];
 }
 
 double body_get_rate(Body *body) {
     assert(body != NULL);
-    return body->rate;
+    return columns.rate[body->index];
 }
 
 void body_set_rate(Body *body, double rate) {
     assert(body != NULL);
-    body->rate = rate;
+    columns.rate[body->index] = rate;
 }
 
 void body_set_centroid(Body *body, Vector x) {
     assert(body != NULL);
-    body->centroid = x;
+    size_t row = body->index;
+    if (columns.centroid_x[row] == x.x && columns.centroid_y[row] == x.y) {
+        return;
+    }
+    columns.centroid_x[row] = x.x;
+    columns.centroid_y[row] = x.y;
+    body->world_shape_dirty = true;
 }
 
 void body_set_velocity(Body *body, Vector v) {
     assert(body != NULL);
-    body->velocity = v;
+    columns.velocity_x[body->index] = v.x;
+    columns.velocity_y[body->index] = v.y;
 }
 
 void body_set_rotation(Body *body, double angle) {
     assert(body != NULL);
-    body->angle = angle;
+    if (columns.angle[body->index] == angle) {
+        return;
+    }
+    columns.angle[body->index] = angle;
+    body->world_shape_dirty = true;
+    body->world_axes_dirty = true;
+    body->local_aabb_dirty = true;
 }
 
 void body_add_force(Body *body, Vector force) {
     assert(body != NULL);
 
     if (body_get_mass(body) != INFINITY) {
-        body->force = vec_add(body->force, force);
+        columns.force_x[body->index] += force.x;
+        columns.force_y[body->index] += force.y;
     }
 }
 
+Vector body_get_force(Body *body) {
+    assert(body != NULL);
+    return (Vector) {columns.force_x[body->index],
+        columns.force_y[body->index]};
+}
+
 void body_add_impulse(Body *body, Vector impulse) {
     assert(body != NULL);
-    body->impulse = vec_add(body->impulse, impulse);
+    columns.impulse_x[body->index] += impulse.x;
+    columns.impulse_y[body->index] += impulse.y;
+}
+
+Vector body_get_impulse(Body *body) {
+    assert(body != NULL);
+    return (Vector) {columns.impulse_x[body->index],
+        columns.impulse_y[body->index]};
+}
+
+/**
+ * Integrates the motion of the bodies in a contiguous range of rows
+ * over a time step. The loop has no indirection or calls,
+ * so the compiler can vectorize it. The columns are passed by value
+ * so the compiler applies their restrict qualifiers.
+ * The result matches what body_tick() used to compute one body at a time.
+ * Records in the moved column which rows changed position or angle.
+ */
+void integrate_rows(BodyColumns c, size_t begin, size_t end, double dt) {
+    double inv_dt = 1.0 / dt;
+
+    for (size_t r = begin; r < end; r++) {
+        double force_scale = 1.0 / c.mass[r];
+        double impulse_scale = inv_dt / c.mass[r];
+        double dv_x = dt * (force_scale * c.force_x[r]
+            + impulse_scale * c.impulse_x[r]);
+        double dv_y = dt * (force_scale * c.force_y[r]
+            + impulse_scale * c.impulse_y[r]);
+
+        double angle = c.angle[r] + c.rate[r] * M_PI * dt;
+        double centroid_x = c.centroid_x[r]
+            + dt * (c.velocity_x[r] + 0.5 * dv_x);
+        double centroid_y = c.centroid_y[r]
+            + dt * (c.velocity_y[r] + 0.5 * dv_y);
+        c.moved[r] = ((centroid_x != c.centroid_x[r]
+            || centroid_y != c.centroid_y[r]) ? MOVED_CENTROID : 0)
+            | (angle != c.angle[r] ? MOVED_ANGLE : 0);
+
+        c.angle[r] = angle;
+        c.centroid_x[r] = centroid_x;
+        c.centroid_y[r] = centroid_y;
+        c.velocity_x[r] = c.velocity_x[r] + dv_x;
+        c.velocity_y[r] = c.velocity_y[r] + dv_y;
+        c.force_x[r] = 0;
+        c.force_y[r] = 0;
+        c.impulse_x[r] = 0;
+        c.impulse_y[r] = 0;
+    }
+}
+
+// Dirties the caches a body's last integration invalidated
+void body_mark_moved(Body *body) {
+    uint8_t moved = columns.moved[body->index];
+    if (moved != 0) {
+        body->world_shape_dirty = true;
+    }
+    // Translation leaves the edge normals and local bounding box alone
+    if (moved & MOVED_ANGLE) {
+        body->world_axes_dirty = true;
+        body->local_aabb_dirty = true;
+    }
 }
 
 void body_tick(Body *body, double dt) {
@@ -158,19 +593,76 @@ void body_tick(Body *body, double dt) {
         return;
     }
 
-    Vector a   = vec_add(vec_multiply(1.0 / body_get_mass(body), body->force), 
-        vec_multiply((1.0 / dt) / body_get_mass(body), body->impulse));
-    Vector dv  = vec_multiply(dt, a);
-    Vector avg = vec_add(body_get_velocity(body), vec_multiply(0.5, dv));
-    Vector dx  = vec_multiply(dt, avg);
+    size_t row = body->index;
+    // A body at rest with nothing acting on it stays put
+    if (columns.velocity_x[row] == 0 && columns.velocity_y[row] == 0
+        && columns.rate[row] == 0
+        && columns.force_x[row] == 0 && columns.force_y[row] == 0
+        && columns.impulse_x[row] == 0 && columns.impulse_y[row] == 0) {
+        return;
+    }
+
+    integrate_rows(columns, row, row + 1, dt);
+    body_mark_moved(body);
+}
 
-    double angle = body_get_angle(body);
-    double new_angle = angle + body_get_rate(body) * M_PI * dt;
-    body_set_rotation(body, new_angle);
-    body_set_centroid(body, vec_add(body->centroid, dx));
-    body_set_velocity(body, vec_add(body->velocity, dv));
-    body->force = (Vector) {0, 0};
-    body->impulse = (Vector) {0, 0};
+/**
+ * RangeFunc integrating the sorted rows batch_rows[begin..end),
+ * one vectorized loop per run of consecutive rows.
+ */
+void integrate_batch_rows(double *dt, size_t begin, size_t end) {
+    uint32_t *rows = batch_rows.data;
+    size_t start = begin;
+    for (size_t i = begin + 1; i <= end; i++) {
+        if (i == end || rows[i] != rows[i - 1] + 1) {
+            integrate_rows(columns, rows[start], rows[i - 1] + 1, *dt);
+            start = i;
+        }
+    }
+}
+
+void body_tick_batch(Body **bodies, size_t count, double dt,
+    ThreadPool *pool) {
+    assert(bodies != NULL || count == 0);
+
+    if (dt == 0) {
+        return;
+    }
+
+    if (batch_rows.data == NULL) {
+        row_array_init(&batch_rows, count);
+    }
+    row_array_clear(&batch_rows);
+    row_array_reserve(&batch_rows, count);
+
+    // Mark the rows, then collect them in slot order. Freed slots are
+    // reused in any order, so the bodies' own order says little about it.
+    size_t marked = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!bodies[i]->is_removed && !columns.in_batch[bodies[i]->index]) {
+            columns.in_batch[bodies[i]->index] = true;
+            marked++;
+        }
+    }
+    for (size_t r = 0; batch_rows.size < marked; r++) {
+        if (columns.in_batch[r]) {
+            columns.in_batch[r] = false;
+            ARRAY_AT(&batch_rows, batch_rows.size++) = r;
+        }
+    }
+
+    if (pool == NULL) {
+        integrate_batch_rows(&dt, 0, batch_rows.size);
+    } else {
+        thread_pool_for(pool, batch_rows.size, INTEGRATE_GRAIN,
+            (RangeFunc) integrate_batch_rows, &dt);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (!bodies[i]->is_removed) {
+            body_mark_moved(bodies[i]);
+        }
+    }
 }
 
 void body_remove(Body *body) {
@@ -183,6 +675,51 @@ bool body_is_removed(Body *body) {
     return body->is_removed;
 }
 
+size_t body_get_proxy(Body *body) {
+    assert(body != NULL);
+    return body->proxy;
+}
+
+void body_set_proxy(Body *body, size_t proxy) {
+    assert(body != NULL);
+    body->proxy = proxy;
+}
+
+int body_get_tag(Body *body) {
+    assert(body != NULL);
+    return body->tag;
+}
+
+void body_set_tag(Body *body, int tag) {
+    assert(body != NULL);
+    body->tag = tag;
+}
+
+uint32_t body_get_category(Body *body) {
+    assert(body != NULL);
+    return body->category;
+}
+
+void body_set_category(Body *body, uint32_t category) {
+    assert(body != NULL);
+    body->category = category;
+}
+
+uint32_t body_get_mask(Body *body) {
+    assert(body != NULL);
+    return body->mask;
+}
+
+void body_set_mask(Body *body, uint32_t mask) {
+    assert(body != NULL);
+    body->mask = mask;
+}
+
+bool body_masks_match(Body *body1, Body *body2) {
+    assert(body1 != NULL && body2 != NULL);
+    return (body1->category == 0 || (body1->category & body2->mask) != 0)
+        && (body2->category == 0 || (body2->category & body1->mask) != 0);
+}
 
 void body_collided(Body *body, bool stat) {
     assert(body != NULL);
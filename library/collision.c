@@ -1,9 +1,13 @@
 #include <stdlib.h>
 #include <math.h>
 #include "collision.h"
+#include "gjk.h"
 
 #define UNDEFINED_VEC (Vector) {0, 0}
 #define DEFAULT_OVERLAP 0
+// Polygon pairs with at least this many vertices in total use GJK,
+// below it SAT's simple loops are cheaper
+#define GJK_VERTEX_THRESHOLD 96
 
 
 
@@ -87,3 +91,339 @@ CollisionInfo find_collision(List *shape1, List *shape2) {
     return (CollisionInfo) {.collided = false, .axis = UNDEFINED_VEC, DEFAULT_OVERLAP};
 
 }
+
+
+// Returns projection of a given packed shape to a given axis
+Projection get_projection_packed(Polygon *shape, Vector axis) {
+    return project_vertices(shape->vertices, shape->size, axis);
+}
+
+
+// Same as projections_overlap(), for packed shapes
+CollisionInfo projections_overlap_packed(Polygon *shape_primary,
+    Polygon *shape_secondary, double min_val, Vector prev_axis)
+{
+    double min_overlap = min_val;
+    Vector col_axis = prev_axis;
+    size_t shape_size = shape_primary->size;
+    Vector *vertices = shape_primary->vertices;
+    for (size_t i = 0; i < shape_size; i++) {
+        Vector axis = get_axis(vertices[i],
+            vertices[i + 1 == shape_size ? 0 : i + 1]);
+        Projection p1 = get_projection_packed(shape_primary, axis);
+        Projection p2 = get_projection_packed(shape_secondary, axis);
+
+        if (!overlaps(p1, p2)) {
+            return (CollisionInfo) {.collided = false, .min_overlap = 0,
+                .axis = col_axis};
+        }
+
+        // amount in which the projections overlap by
+        double diff = getOverlap(p1, p2);
+        if (diff < min_overlap) {
+            min_overlap = diff;
+            col_axis = axis;
+        }
+    }
+
+    return (CollisionInfo) {.collided = true, .min_overlap = min_overlap,
+        .axis = col_axis};
+}
+
+
+CollisionInfo find_collision_packed(Polygon *shape1, Polygon *shape2) {
+    // really large min_overlap value
+    CollisionInfo c1 = projections_overlap_packed(shape1, shape2,
+                                             1000, UNDEFINED_VEC);
+
+    if (c1.collided) {
+        CollisionInfo c2 = projections_overlap_packed(shape2, shape1,
+                                            c1.min_overlap, c1.axis);
+        if (c2.collided) {
+            return (CollisionInfo) {.collided = true, .axis = c2.axis, DEFAULT_OVERLAP};
+        }
+    }
+
+    return (CollisionInfo) {.collided = false, .axis = UNDEFINED_VEC, DEFAULT_OVERLAP};
+}
+
+
+// Same as projections_overlap_packed(), testing only the given axes.
+// If the shapes are separated, the axis returned is the one separating them.
+CollisionInfo projections_overlap_axes(Polygon *axes, Polygon *shape_primary,
+    Polygon *shape_secondary, double min_val, Vector prev_axis)
+{
+    double min_overlap = min_val;
+    Vector col_axis = prev_axis;
+    for (size_t i = 0; i < axes->size; i++) {
+        Vector axis = axes->vertices[i];
+        Projection p1 = get_projection_packed(shape_primary, axis);
+        Projection p2 = get_projection_packed(shape_secondary, axis);
+
+        if (!overlaps(p1, p2)) {
+            return (CollisionInfo) {.collided = false, .min_overlap = 0,
+                .axis = axis};
+        }
+
+        // amount in which the projections overlap by
+        double diff = getOverlap(p1, p2);
+        if (diff < min_overlap) {
+            min_overlap = diff;
+            col_axis = axis;
+        }
+    }
+
+    return (CollisionInfo) {.collided = true, .min_overlap = min_overlap,
+        .axis = col_axis};
+}
+
+
+CollisionInfo find_collision_with_axes(Polygon *shape1, Polygon *axes1,
+    Polygon *shape2, Polygon *axes2) {
+    // really large min_overlap value
+    CollisionInfo c1 = projections_overlap_axes(axes1, shape1, shape2,
+                                             1000, UNDEFINED_VEC);
+
+    if (c1.collided) {
+        return projections_overlap_axes(axes2, shape2, shape1,
+                                            c1.min_overlap, c1.axis);
+    }
+
+    return c1;
+}
+
+
+CollisionInfo find_collision_circles(Vector center1, double radius1,
+    Vector center2, double radius2) {
+    Vector diff = vec_subtract(center2, center1);
+    double dist_squared = vec_dot(diff, diff);
+    double reach = radius1 + radius2;
+
+    if (dist_squared > reach * reach) {
+        return (CollisionInfo) {.collided = false, .axis = vec_normalize(diff),
+            DEFAULT_OVERLAP};
+    }
+
+    // Concentric circles can be pushed apart along any axis
+    Vector axis = dist_squared > 0 ? vec_normalize(diff) : (Vector) {1, 0};
+    return (CollisionInfo) {.collided = true, .axis = axis,
+        .min_overlap = reach - sqrt(dist_squared)};
+}
+
+
+// Adds one axis to a circle-polygon test; returns false if it separates them
+bool circle_axis_overlaps(Vector center, double radius, Polygon *shape,
+    Vector axis, double *min_overlap, Vector *col_axis) {
+    double c = vec_dot(center, axis);
+    Projection p1 = {.min = c - radius, .max = c + radius};
+    Projection p2 = get_projection_packed(shape, axis);
+
+    if (!overlaps(p1, p2)) {
+        return false;
+    }
+
+    // amount in which the projections overlap by
+    double diff = getOverlap(p1, p2);
+    if (diff < *min_overlap) {
+        *min_overlap = diff;
+        *col_axis = axis;
+    }
+    return true;
+}
+
+
+CollisionInfo find_collision_circle_polygon(Vector center, double radius,
+    Polygon *shape, Polygon *axes) {
+    CollisionInfo none =
+        {.collided = false, .axis = UNDEFINED_VEC, DEFAULT_OVERLAP};
+    // really large min_overlap value
+    double min_overlap = 1000;
+    Vector col_axis = UNDEFINED_VEC;
+
+    for (size_t i = 0; i < axes->size; i++) {
+        if (!circle_axis_overlaps(center, radius, shape, axes->vertices[i],
+            &min_overlap, &col_axis)) {
+            none.axis = axes->vertices[i];
+            return none;
+        }
+    }
+
+    // The only axis the circle adds points at the polygon's closest vertex
+    Vector closest = shape->vertices[0];
+    Vector diff = vec_subtract(closest, center);
+    double closest_dist = vec_dot(diff, diff);
+    for (size_t i = 1; i < shape->size; i++) {
+        diff = vec_subtract(shape->vertices[i], center);
+        double dist = vec_dot(diff, diff);
+        if (dist < closest_dist) {
+            closest = shape->vertices[i];
+            closest_dist = dist;
+        }
+    }
+
+    Vector vertex_axis = closest_dist > 0
+        ? vec_normalize(vec_subtract(closest, center)) : UNDEFINED_VEC;
+    if (closest_dist > 0 && !circle_axis_overlaps(center, radius, shape,
+        vertex_axis, &min_overlap, &col_axis)) {
+        none.axis = vertex_axis;
+        return none;
+    }
+
+    return (CollisionInfo) {.collided = true, .axis = col_axis,
+        .min_overlap = min_overlap};
+}
+
+
+CollisionInfo find_collision_boxes(Vector center1, Vector half1,
+    const Vector *axes1, Vector center2, Vector half2, const Vector *axes2) {
+    // Each box's extent along an axis is its half-extents weighted by
+    // how far its own axes lean into it
+    double dots[2][2];
+    for (size_t i = 0; i < 2; i++) {
+        for (size_t j = 0; j < 2; j++) {
+            dots[i][j] = fabs(vec_dot(axes1[i], axes2[j]));
+        }
+    }
+
+    Vector axes[4] = {axes1[0], axes1[1], axes2[0], axes2[1]};
+    double radii1[4] = {half1.x, half1.y,
+        half1.x * dots[0][0] + half1.y * dots[1][0],
+        half1.x * dots[0][1] + half1.y * dots[1][1]};
+    double radii2[4] = {half2.x * dots[0][0] + half2.y * dots[0][1],
+        half2.x * dots[1][0] + half2.y * dots[1][1], half2.x, half2.y};
+
+    // really large min_overlap value, as in find_collision_with_axes()
+    double min_overlap = 1000;
+    Vector col_axis = UNDEFINED_VEC;
+    for (size_t i = 0; i < 4; i++) {
+        double c1 = vec_dot(center1, axes[i]);
+        double c2 = vec_dot(center2, axes[i]);
+        Projection p1 = {.min = c1 - radii1[i], .max = c1 + radii1[i]};
+        Projection p2 = {.min = c2 - radii2[i], .max = c2 + radii2[i]};
+
+        if (!overlaps(p1, p2)) {
+            return (CollisionInfo) {.collided = false, .axis = axes[i],
+                DEFAULT_OVERLAP};
+        }
+
+        double diff = getOverlap(p1, p2);
+        if (diff < min_overlap) {
+            min_overlap = diff;
+            col_axis = axes[i];
+        }
+    }
+
+    return (CollisionInfo) {.collided = true, .axis = col_axis,
+        .min_overlap = min_overlap};
+}
+
+
+// Same as find_body_collision(), without checking the bodies' bounds first
+CollisionInfo find_shape_collision(Body *body1, Body *body2) {
+    bool circle1 = body_get_shape_type(body1) == SHAPE_CIRCLE;
+    bool circle2 = body_get_shape_type(body2) == SHAPE_CIRCLE;
+
+    if (circle1 && circle2) {
+        return find_collision_circles(body_get_centroid(body1),
+            body_get_radius(body1), body_get_centroid(body2),
+            body_get_radius(body2));
+    }
+    if (circle1) {
+        return find_collision_circle_polygon(body_get_centroid(body1),
+            body_get_radius(body1), body_borrow_polygon(body2),
+            body_borrow_axes(body2));
+    }
+    if (circle2) {
+        return find_collision_circle_polygon(body_get_centroid(body2),
+            body_get_radius(body2), body_borrow_polygon(body1),
+            body_borrow_axes(body1));
+    }
+    if (body_get_shape_type(body1) == SHAPE_BOX
+        && body_get_shape_type(body2) == SHAPE_BOX) {
+        return find_collision_boxes(body_get_centroid(body1),
+            body_get_half_extents(body1), body_borrow_axes(body1)->vertices,
+            body_get_centroid(body2), body_get_half_extents(body2),
+            body_borrow_axes(body2)->vertices);
+    }
+    Polygon *shape1 = body_borrow_polygon(body1);
+    Polygon *shape2 = body_borrow_polygon(body2);
+    if (shape1->size + shape2->size >= GJK_VERTEX_THRESHOLD
+        && body_is_convex(body1) && body_is_convex(body2)) {
+        return find_collision_gjk(shape1, shape2);
+    }
+    return find_collision_with_axes(shape1, body_borrow_axes(body1), shape2,
+        body_borrow_axes(body2));
+}
+
+
+// Checks whether two bodies' bounding circles or bounding boxes are apart,
+// which rules out a collision without looking at their vertices.
+// If they are, sets *axis to an axis that separates the bodies.
+bool bounds_separated(Body *body1, Body *body2, Vector *axis) {
+    Vector diff = vec_subtract(body_get_centroid(body2),
+        body_get_centroid(body1));
+    double reach = body_get_bounding_radius(body1)
+        + body_get_bounding_radius(body2);
+    double dist_squared = vec_dot(diff, diff);
+    if (dist_squared > reach * reach) {
+        *axis = vec_normalize(diff);
+        return true;
+    }
+
+    AABB box1 = body_get_aabb(body1);
+    AABB box2 = body_get_aabb(body2);
+    if (box1.max.x < box2.min.x || box2.max.x < box1.min.x) {
+        *axis = (Vector) {1, 0};
+        return true;
+    }
+    if (box1.max.y < box2.min.y || box2.max.y < box1.min.y) {
+        *axis = (Vector) {0, 1};
+        return true;
+    }
+    return false;
+}
+
+
+CollisionInfo find_body_collision(Body *body1, Body *body2) {
+    Vector axis;
+    if (bounds_separated(body1, body2, &axis)) {
+        return (CollisionInfo) {.collided = false, .axis = axis,
+            DEFAULT_OVERLAP};
+    }
+    return find_shape_collision(body1, body2);
+}
+
+
+// Returns the projection of a body's current shape onto a given axis
+Projection get_projection_body(Body *body, Vector axis) {
+    if (body_get_shape_type(body) == SHAPE_CIRCLE) {
+        double center = vec_dot(body_get_centroid(body), axis);
+        double radius = body_get_radius(body);
+        return (Projection) {.min = center - radius, .max = center + radius};
+    }
+    return get_projection_packed(body_borrow_polygon(body), axis);
+}
+
+
+CollisionInfo find_body_collision_cached(Body *body1, Body *body2,
+    Vector *separating_axis) {
+    Vector axis;
+    if (bounds_separated(body1, body2, &axis)) {
+        return (CollisionInfo) {.collided = false, .axis = axis,
+            DEFAULT_OVERLAP};
+    }
+
+    axis = *separating_axis;
+    if (axis.x != 0 || axis.y != 0) {
+        Projection p1 = get_projection_body(body1, axis);
+        Projection p2 = get_projection_body(body2, axis);
+        if (!overlaps(p1, p2)) {
+            return (CollisionInfo) {.collided = false, .axis = axis,
+                DEFAULT_OVERLAP};
+        }
+    }
+
+    CollisionInfo collision = find_shape_collision(body1, body2);
+    *separating_axis = collision.collided ? UNDEFINED_VEC : collision.axis;
+    return collision;
+}
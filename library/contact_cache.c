@@ -0,0 +1,156 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "array.h"
+#include "contact_cache.h"
+
+#define INIT_SIZE 16
+#define INIT_SLOTS 32
+#define NO_CONTACT SIZE_MAX
+#define INC_FACTOR 2
+
+ARRAY_DEFINE(ContactArray, Contact, contact_array)
+
+/**
+ * The contacts of one tick, indexed by an open-addressing hash table.
+ *
+ * @param contacts   the contacts, in the order they were added.
+ * @param slots      the index of a contact in contacts, or NO_CONTACT.
+ *   A contact is in the first free slot at or after its hash.
+ * @param slot_count the number of slots, always a power of two
+ *   and at least twice the number of contacts.
+ */
+typedef struct {
+    ContactArray contacts;
+    size_t *slots;
+    size_t slot_count;
+} contact_table;
+
+/**
+ * @param current  the contacts of the current tick.
+ * @param previous the contacts of the previous tick.
+ */
+struct contact_cache {
+    contact_table current;
+    contact_table previous;
+};
+
+void contact_table_init(contact_table *table) {
+    contact_array_init(&table->contacts, INIT_SIZE);
+    table->slot_count = INIT_SLOTS;
+    table->slots = malloc(INIT_SLOTS * sizeof(size_t));
+    assert(table->slots != NULL);
+    for (size_t i = 0; i < INIT_SLOTS; i++) {
+        table->slots[i] = NO_CONTACT;
+    }
+}
+
+void contact_table_clear(contact_table *table) {
+    contact_array_clear(&table->contacts);
+    for (size_t i = 0; i < table->slot_count; i++) {
+        table->slots[i] = NO_CONTACT;
+    }
+}
+
+size_t contact_hash(BodyHandle body1, BodyHandle body2) {
+    uint64_t h = ((uint64_t) body1.index << 32 | body2.index)
+        * 0x9E3779B97F4A7C15u;
+    return (size_t) (h >> 32);
+}
+
+bool contact_matches(Contact *contact, BodyHandle body1, BodyHandle body2) {
+    return contact->body1.index == body1.index
+        && contact->body1.generation == body1.generation
+        && contact->body2.index == body2.index
+        && contact->body2.generation == body2.generation;
+}
+
+// Returns the slot holding the contact between two bodies,
+// or the free slot it would go in
+size_t *contact_table_slot(contact_table *table, BodyHandle body1,
+    BodyHandle body2) {
+    size_t mask = table->slot_count - 1;
+    size_t slot = contact_hash(body1, body2) & mask;
+    while (table->slots[slot] != NO_CONTACT
+        && !contact_matches(&ARRAY_AT(&table->contacts, table->slots[slot]),
+            body1, body2)) {
+        slot = (slot + 1) & mask;
+    }
+    return &table->slots[slot];
+}
+
+void contact_table_grow(contact_table *table) {
+    free(table->slots);
+    table->slot_count *= INC_FACTOR;
+    table->slots = malloc(table->slot_count * sizeof(size_t));
+    assert(table->slots != NULL);
+    for (size_t i = 0; i < table->slot_count; i++) {
+        table->slots[i] = NO_CONTACT;
+    }
+
+    for (size_t i = 0; i < table->contacts.size; i++) {
+        Contact *contact = &ARRAY_AT(&table->contacts, i);
+        *contact_table_slot(table, contact->body1, contact->body2) = i;
+    }
+}
+
+ContactCache *contact_cache_init(void) {
+    ContactCache *res = malloc(sizeof(ContactCache));
+    assert(res != NULL);
+    contact_table_init(&res->current);
+    contact_table_init(&res->previous);
+    return res;
+}
+
+void contact_cache_free(ContactCache *cache) {
+    assert(cache != NULL);
+    contact_array_free(&cache->current.contacts);
+    free(cache->current.slots);
+    contact_array_free(&cache->previous.contacts);
+    free(cache->previous.slots);
+    free(cache);
+}
+
+void contact_cache_next_tick(ContactCache *cache) {
+    assert(cache != NULL);
+    contact_table tmp = cache->previous;
+    cache->previous = cache->current;
+    cache->current = tmp;
+    contact_table_clear(&cache->current);
+}
+
+Contact *contact_cache_add(ContactCache *cache, BodyHandle body1,
+    BodyHandle body2) {
+    assert(cache != NULL);
+    contact_table *current = &cache->current;
+    size_t *slot = contact_table_slot(current, body1, body2);
+    if (*slot != NO_CONTACT) {
+        return &ARRAY_AT(&current->contacts, *slot);
+    }
+
+    Contact contact = {.body1 = body1, .body2 = body2, .impulse = 0,
+        .ticks = 1};
+    size_t prev_slot = *contact_table_slot(&cache->previous, body1, body2);
+    if (prev_slot != NO_CONTACT) {
+        Contact *prev = &ARRAY_AT(&cache->previous.contacts, prev_slot);
+        contact.impulse = prev->impulse;
+        contact.ticks = prev->ticks + 1;
+    }
+
+    *slot = current->contacts.size;
+    contact_array_add(&current->contacts, contact);
+    if (current->contacts.size * INC_FACTOR > current->slot_count) {
+        contact_table_grow(current);
+    }
+    return &ARRAY_AT(&current->contacts, current->contacts.size - 1);
+}
+
+size_t contact_cache_size(ContactCache *cache) {
+    assert(cache != NULL);
+    return cache->current.contacts.size;
+}
+
+Contact *contact_cache_get(ContactCache *cache, size_t index) {
+    assert(cache != NULL && index < cache->current.contacts.size);
+    return &ARRAY_AT(&cache->current.contacts, index);
+}
@@ -1,27 +1,85 @@
 #include "forces.h"
 
 #define CLOSE 1
+#define INIT_LINKS 16
+#define GRAVITY_GRAIN 64
 
 typedef struct {
     double constant;
-    List *bodies;
+    Body *body1;
+    Body *body2;
+    Vector separating_axis; // last axis the collision creators saw apart
+    bool collided; // result of this tick's collision_test
 } force_info;
 
 
 typedef struct {
-    List *bodies;
+    Scene *scene; // where the collision events go
+    Body *body1;
+    Body *body2;
     void *aux_val;
     CollisionHandler handler;
+    double elasticity; // only used by physics collisions
     bool collided_before;
+    Vector separating_axis; // axis that separated the bodies last tick
+    CollisionInfo collision; // result of this tick's collision_test
 } collision_info;
 
+// The handler of a category collision, shared by all the pairs it creates
+typedef struct {
+    Scene *scene;
+    CollisionHandler handler;
+    void *aux_val;
+    FreeFunc freer;
+    double elasticity;
+} collision_response;
 
-void gravity_creator(force_info *aux) {
-    assert(aux != NULL);
-    double G = aux->constant;
-    Body *body1 = (Body *) list_get(aux->bodies, 0);
-    Body *body2 = (Body *) list_get(aux->bodies, 1);
-    assert(G > 0 && body1 != NULL && body2 != NULL);
+
+/**
+ * One link of a batched force: the bodies it acts on and its constant.
+ * Drag links only use body1.
+ */
+typedef struct {
+    BodyHandle body1;
+    BodyHandle body2;
+    double constant;
+} force_link;
+
+ARRAY_DEFINE(ForceLinkArray, force_link, force_link_array)
+
+
+void force_links_free(ForceLinkArray *links) {
+    force_link_array_free(links);
+    free(links);
+}
+
+// Drag links repeat body1 as body2, so this works for every kind of link
+bool force_link_is_freed(force_link link, void *aux) {
+    return body_from_handle(link.body1) == NULL
+        || body_from_handle(link.body2) == NULL;
+}
+
+/**
+ * Gets the links of a scene's batched force, creating the batch the first
+ * time. Each batch is a single force creator that runs all of its links in
+ * one loop per tick, so adding a link is just appending to the array.
+ */
+ForceLinkArray *get_force_links(Scene *scene, ForceCreator batch) {
+    ForceLinkArray *links = scene_find_force_creator(scene, batch);
+
+    if (links == NULL) {
+        links = malloc(sizeof(ForceLinkArray));
+        assert(links != NULL);
+        force_link_array_init(links, INIT_LINKS);
+        // The batch outlives any one body, so it is registered with none
+        scene_add_bodies_force_creator(scene, batch, links,
+            list_init(0, NULL), (FreeFunc) force_links_free);
+    }
+    return links;
+}
+
+void apply_gravity(double G, Body *body1, Body *body2) {
+    assert(G > 0);
     double m1 = body_get_mass(body1);
     double m2 = body_get_mass(body2);
     Vector r  = vec_subtract(body_get_centroid(body2), body_get_centroid(body1));
@@ -35,81 +93,184 @@ void gravity_creator(force_info *aux) {
     }
 }
 
+/**
+ * Applies every gravity link, dropping links whose bodies have been freed.
+ * A link still acts on the tick its body is removed, like a force creator
+ * registered with the body would.
+ */
+void gravity_batch(ForceLinkArray *links) {
+    force_link_array_remove_if(links, force_link_is_freed, NULL);
+    for (size_t i = 0; i < links->size; i++) {
+        force_link link = ARRAY_AT(links, i);
+        apply_gravity(link.constant,
+            body_from_handle(link.body1), body_from_handle(link.body2));
+    }
+}
+
 void create_newtonian_gravity(Scene *scene, double G, Body *body1, Body *body2) {
     assert(scene != NULL && G > 0 && body1 != NULL && body2 != NULL);
-    force_info *aux = malloc(sizeof(force_info));
-    assert(aux != NULL);
-    aux->constant = G;
+    force_link_array_add(
+        get_force_links(scene, (ForceCreator) gravity_batch),
+        (force_link) {.body1 = body_get_handle(body1),
+            .body2 = body_get_handle(body2), .constant = G});
+}
 
-    List *bodies = list_init(2, NULL);
-    list_add(bodies, body1);
-    list_add(bodies, body2);
-    aux->bodies = bodies;
+ARRAY_DEFINE(VectorArray, Vector, vector_array)
+
+/**
+ * A scene-wide gravity field over a set of bodies.
+ *
+ * @param G      the gravitational proportionality constant.
+ * @param theta  the opening angle passed to barnes_hut_field().
+ * @param bodies the bodies in the field.
+ * @param tree   the quadtree, rebuilt every tick.
+ * @param scene  the scene the field is in, for its thread pool.
+ * @param pulls  each body's pull from the others on the current tick.
+ */
+struct gravity_field {
+    double G;
+    double theta;
+    BodyHandleArray bodies;
+    BarnesHut *tree;
+    Scene *scene;
+    VectorArray pulls;
+};
+
+void gravity_field_free(GravityField *field) {
+    body_handle_array_free(&field->bodies);
+    barnes_hut_free(field->tree);
+    vector_array_free(&field->pulls);
+    free(field);
+}
 
-    scene_add_bodies_force_creator(scene, (ForceCreator) gravity_creator, aux,
-        bodies, (FreeFunc) free);
+bool body_handle_is_freed(BodyHandle handle, void *aux) {
+    return body_from_handle(handle) == NULL;
 }
 
-void spring_creator(force_info *aux) {
-    assert(aux != NULL);
-    double k = aux->constant;
-    Body *body1 = (Body *) list_get(aux->bodies, 0);
-    Body *body2 = (Body *) list_get(aux->bodies, 1);
-    assert(k > 0 && body1 != NULL && body2 != NULL);
+// RangeFunc finding the pulls on a range of a field's bodies
+void find_gravity_pulls(GravityField *field, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        Body *body = body_from_handle(ARRAY_AT(&field->bodies, i));
+        ARRAY_AT(&field->pulls, i) = barnes_hut_field(field->tree,
+            body_get_centroid(body), field->theta, CLOSE, i);
+    }
+}
+
+/**
+ * Rebuilds the field's quadtree over its bodies' current positions,
+ * then adds the force from all the other bodies to each one.
+ * Bodies are added to the tree in order, so body i is point i.
+ * The tree queries are split across the scene's threads, if it has any;
+ * the forces are then added in order on this thread.
+ */
+void gravity_field_creator(GravityField *field) {
+    BodyHandleArray *bodies = &field->bodies;
+    body_handle_array_remove_if(bodies, body_handle_is_freed, NULL);
+
+    barnes_hut_clear(field->tree);
+    for (size_t i = 0; i < bodies->size; i++) {
+        Body *body = body_from_handle(ARRAY_AT(bodies, i));
+        barnes_hut_add(field->tree, body_get_centroid(body),
+            body_get_mass(body));
+    }
+    barnes_hut_build(field->tree);
+
+    vector_array_reserve(&field->pulls, bodies->size);
+    field->pulls.size = bodies->size;
+    ThreadPool *pool = scene_get_thread_pool(field->scene);
+    if (pool == NULL) {
+        find_gravity_pulls(field, 0, bodies->size);
+    } else {
+        thread_pool_for(pool, bodies->size, GRAVITY_GRAIN,
+            (RangeFunc) find_gravity_pulls, field);
+    }
+
+    for (size_t i = 0; i < bodies->size; i++) {
+        Body *body = body_from_handle(ARRAY_AT(bodies, i));
+        body_add_force(body, vec_multiply(field->G * body_get_mass(body),
+            ARRAY_AT(&field->pulls, i)));
+    }
+}
+
+GravityField *create_gravity_field(Scene *scene, double G, double theta) {
+    assert(scene != NULL && G > 0 && theta >= 0);
+    GravityField *field = malloc(sizeof(GravityField));
+    assert(field != NULL);
+    field->G = G;
+    field->theta = theta;
+    body_handle_array_init(&field->bodies, INIT_LINKS);
+    field->tree = barnes_hut_init();
+    field->scene = scene;
+    vector_array_init(&field->pulls, INIT_LINKS);
+
+    // Like the batched forces, the field outlives any one body
+    scene_add_bodies_force_creator(scene, (ForceCreator) gravity_field_creator,
+        field, list_init(0, NULL), (FreeFunc) gravity_field_free);
+    return field;
+}
+
+void gravity_field_add_body(GravityField *field, Body *body) {
+    assert(field != NULL && body != NULL);
+    assert(isfinite(body_get_mass(body)));
+    body_handle_array_add(&field->bodies, body_get_handle(body));
+}
+
+void apply_spring(double k, Body *body1, Body *body2) {
+    assert(k > 0);
     Vector x  = vec_subtract(body_get_centroid(body2), body_get_centroid(body1));
 
     body_add_force(body1, vec_multiply(k, x));
     body_add_force(body2, vec_multiply(-k, x));
 }
 
+// Same as gravity_batch(), for spring links
+void spring_batch(ForceLinkArray *links) {
+    force_link_array_remove_if(links, force_link_is_freed, NULL);
+    for (size_t i = 0; i < links->size; i++) {
+        force_link link = ARRAY_AT(links, i);
+        apply_spring(link.constant,
+            body_from_handle(link.body1), body_from_handle(link.body2));
+    }
+}
+
 void create_spring(Scene *scene, double k, Body *body1, Body *body2) {
     assert(scene != NULL && k >= 0 && body1 != NULL && body2 != NULL);
-    force_info *aux = malloc(sizeof(force_info));
-    assert(aux != NULL);
-    aux->constant = k;
-
-    List *bodies = list_init(2, NULL);
-    list_add(bodies, body1);
-    list_add(bodies, body2);
-    aux->bodies = bodies;
-
-    scene_add_bodies_force_creator(scene, (ForceCreator) spring_creator, aux,
-        bodies, (FreeFunc) free);
+    force_link_array_add(
+        get_force_links(scene, (ForceCreator) spring_batch),
+        (force_link) {.body1 = body_get_handle(body1),
+            .body2 = body_get_handle(body2), .constant = k});
 }
 
-void drag_creator(force_info *aux) {
-    assert(aux != NULL);
-    double gamma = aux->constant;
-    Body *body = (Body *) list_get(aux->bodies, 0);
-    assert(gamma >= 0 && body != NULL);
-
-    body_add_force(body, vec_multiply(-gamma, body_get_velocity(body)));
+// Same as gravity_batch(), for drag links
+void drag_batch(ForceLinkArray *links) {
+    force_link_array_remove_if(links, force_link_is_freed, NULL);
+    for (size_t i = 0; i < links->size; i++) {
+        force_link link = ARRAY_AT(links, i);
+        Body *body = body_from_handle(link.body1);
+        body_add_force(body, vec_multiply(-link.constant,
+            body_get_velocity(body)));
+    }
 }
 
 void create_drag(Scene *scene, double gamma, Body *body) {
     assert(scene != NULL && gamma >= 0 && body != NULL);
-    force_info *aux = malloc(sizeof(force_info));
-    assert(aux != NULL);
-    aux->constant = gamma;
-
-    List *bodies = list_init(1, NULL);
-    list_add(bodies, body);
-    aux->bodies = bodies;
+    force_link_array_add(
+        get_force_links(scene, (ForceCreator) drag_batch),
+        (force_link) {.body1 = body_get_handle(body),
+            .body2 = body_get_handle(body), .constant = gamma});
+}
 
-    scene_add_bodies_force_creator(scene, (ForceCreator) drag_creator, aux,
-        bodies, (FreeFunc) free);
+// PairTest for the destructive collisions
+void destruction_test(force_info *aux) {
+    aux->collided = find_body_collision_cached(aux->body1, aux->body2,
+        &aux->separating_axis).collided;
 }
 
 void destruction_creator(force_info *aux) {
     assert(aux != NULL);
-    Body *body1 = (Body *) list_get(aux->bodies, 0);
-    Body *body2 = (Body *) list_get(aux->bodies, 1);
-    List *shape1 = body_get_shape(body1);
-    List *shape2 = body_get_shape(body2);
-
-    if (find_collision(shape1, shape2).collided) {
-        body_remove(body1);
-        body_remove(body2);
+    if (aux->collided) {
+        body_remove(aux->body1);
+        body_remove(aux->body2);
     }
 }
 
@@ -123,9 +284,13 @@ void create_destructive_collision(Scene *scene, Body *body1, Body *body2) {
     List *bodies = list_init(2, NULL);
     list_add(bodies, body1);
     list_add(bodies, body2);
-    aux->bodies = bodies;
+    aux->body1 = body1;
+    aux->body2 = body2;
+    aux->separating_axis = (Vector) {0, 0};
+    aux->collided = false;
 
-    scene_add_bodies_force_creator(scene, (ForceCreator) destruction_creator,
+    scene_add_tested_pair_force_creator(scene,
+        (ForceCreator) destruction_creator, (PairTest) destruction_test,
         aux, bodies, (FreeFunc) free);
 }
 
@@ -133,15 +298,32 @@ void create_destructive_collision(Scene *scene, Body *body1, Body *body2) {
 
 
 
+// PairAuxInit for category responses that keep a force_info per pair
+force_info *force_info_init(Body *body1, Body *body2, void *aux) {
+    force_info *res = malloc(sizeof(force_info));
+    assert(res != NULL);
+    res->constant = 0;
+    res->body1 = body1;
+    res->body2 = body2;
+    res->separating_axis = (Vector) {0, 0};
+    res->collided = false;
+    return res;
+}
+
+
+void create_category_destructive_collision(Scene *scene, uint32_t category1,
+    uint32_t category2) {
+    assert(scene != NULL);
+    scene_add_category_response(scene, category1, category2,
+        (ForceCreator) destruction_creator, (PairTest) destruction_test,
+        (PairAuxInit) force_info_init, (FreeFunc) free, NULL, NULL);
+}
+
+
 void half_destruction_creator(force_info *aux) {
     assert(aux != NULL);
-    Body *body1 = (Body *) list_get(aux->bodies, 0);
-    Body *body2 = (Body *) list_get(aux->bodies, 1);
-    List *shape1 = body_get_shape(body1);
-    List *shape2 = body_get_shape(body2);
-
-    if (find_collision(shape1, shape2).collided) {
-        body_remove(body2);
+    if (aux->collided) {
+        body_remove(aux->body2);
     }
 }
 
@@ -155,99 +337,143 @@ void create_half_destructive_collision(Scene *scene, Body *body1, Body *body2) {
     List *bodies = list_init(2, NULL);
     list_add(bodies, body1);
     list_add(bodies, body2);
-    aux->bodies = bodies;
+    aux->body1 = body1;
+    aux->body2 = body2;
+    aux->separating_axis = (Vector) {0, 0};
+    aux->collided = false;
 
-    scene_add_bodies_force_creator(scene, (ForceCreator) half_destruction_creator,
+    scene_add_tested_pair_force_creator(scene,
+        (ForceCreator) half_destruction_creator, (PairTest) destruction_test,
         aux, bodies, (FreeFunc) free);
 }
 
 
+// PairTest for the collisions; collision_creator() queues the result
+void collision_test(collision_info *aux) {
+    aux->collision = find_body_collision_cached(aux->body1, aux->body2,
+        &aux->separating_axis);
+}
+
+// Queues this tick's event for the pair, if any; see collision_phase()
 void collision_creator(collision_info *aux) {
     assert(aux != NULL);
-    Body *body1 = (Body *) list_get(aux->bodies, 0);
-    Body *body2 = (Body *) list_get(aux->bodies, 1);
-    List *shape1 = body_get_shape(body1);
-    List *shape2 = body_get_shape(body2);
-
-    CollisionInfo collision = find_collision(shape1, shape2);
-    if (collision.collided) {
-        if (!aux->collided_before) {
-
-            // take care of three bullet rule
-            Body_info *body1_info = body_get_info(body1);
-            Body_info *body2_info = body_get_info(body2);
-            if ((*body1_info).b == BULLET1 || (*body1_info).b == BULLET2) {
-                if (get_num_collided(body1) >= 3) {
-                    body_remove(body1);
-                }
-
-                else {
-                    increment_num_collided(body1);
-                }
-            } 
-            if ((*body2_info).b == BULLET1 || (*body2_info).b == BULLET2) {
-                if (get_num_collided(body2) >= 3) {
-                    body_remove(body2);
-                }
-
-                else {
-                    increment_num_collided(body2);
-                }
-            }
-
-            // take care of WALL_BREAK only withholding 3 hits
-            if ((*body1_info).b == WALL_BREAK && ((*body2_info).b == BULLET1 || (*body2_info).b == BULLET2)) {
-                if (get_num_collided(body1) >= 2) {
-                    body_remove(body1);
-                }
-
-                else {
-                    increment_num_collided(body1);
-                    RGBColor color = body_get_color(body1);
-                    RGBColor new_color = {.r = color.r, .g = color.g + 0.15, .b = color.b};
-                    body_set_color(body1, new_color);
-                }
-            }
-
-            if ((*body2_info).b == WALL_BREAK && ((*body1_info).b == BULLET1 || (*body1_info).b == BULLET2)) {
-                if (get_num_collided(body2) >= 2) {
-                    body_remove(body2);
-                }
-
-                else {
-                    increment_num_collided(body2);
-                    RGBColor color = body_get_color(body2);
-                    RGBColor new_color = {.r = color.r, .g = color.g + 0.15, .b = color.b};
-                    body_set_color(body2, new_color);
-                }
-            }
-
-            aux->collided_before = true;
-            aux->handler(body1, body2, collision.axis, aux->aux_val);
-        }
+    CollisionInfo collision = aux->collision;
+    if (!collision.collided && !aux->collided_before) {
+        return;
     }
 
+    CollisionEvent event = {
+        .body1 = body_get_handle(aux->body1),
+        .body2 = body_get_handle(aux->body2),
+        .normal = VEC_ZERO,
+        .depth = 0,
+        .handler = aux->handler,
+        .aux = aux->aux_val};
+    if (!collision.collided) {
+        event.phase = COLLISION_END;
+    }
     else {
-        aux->collided_before = false;
+        event.phase = aux->collided_before ? COLLISION_PERSIST : COLLISION_BEGIN;
+        event.normal = collision.axis;
+        event.depth = collision.min_overlap;
     }
+    aux->collided_before = collision.collided;
+    scene_add_collision_event(aux->scene, event);
+}
 
+
+// Also hands the contact to the scene's solver while the bodies touch
+void physics_creator(collision_info *aux) {
+    collision_creator(aux);
+    if (aux->collision.collided) {
+        scene_add_contact(aux->scene, aux->body1, aux->body2,
+            aux->collision.axis, aux->collision.min_overlap, aux->elasticity);
+    }
 }
 
 
-void create_collision(Scene *scene, Body *body1, Body *body2, CollisionHandler
- handler, void *aux, FreeFunc freer) {
+// Adds a collision between two bodies, run by either creator above
+void add_collision(Scene *scene, Body *body1, Body *body2,
+    ForceCreator forcer, CollisionHandler handler, void *aux,
+    double elasticity, FreeFunc freer) {
     collision_info *aux1 = malloc(sizeof(collision_info));
+    assert(aux1 != NULL);
     List *bodies = list_init(2, NULL);
     list_add(bodies, body1);
     list_add(bodies, body2);
-    aux1->bodies = bodies;
+    aux1->scene = scene;
+    aux1->body1 = body1;
+    aux1->body2 = body2;
     aux1->aux_val = aux;
     aux1->handler = handler;
+    aux1->elasticity = elasticity;
     aux1->collided_before = false;
+    aux1->separating_axis = (Vector) {0, 0};
+
+    scene_add_tested_pair_force_creator(scene, forcer,
+        (PairTest) collision_test, aux1, bodies, freer);
+}
+
+
+void create_collision(Scene *scene, Body *body1, Body *body2, CollisionHandler
+ handler, void *aux, FreeFunc freer) {
+    add_collision(scene, body1, body2, (ForceCreator) collision_creator,
+        handler, aux, 0, freer);
+}
+
 
-    scene_add_bodies_force_creator(scene, (ForceCreator) collision_creator,
-        aux1, bodies, freer);
 
+
+// PairAuxInit for category collisions
+collision_info *collision_info_init(Body *body1, Body *body2,
+    collision_response *response) {
+    collision_info *res = malloc(sizeof(collision_info));
+    assert(res != NULL);
+    res->scene = response->scene;
+    res->body1 = body1;
+    res->body2 = body2;
+    res->aux_val = response->aux_val;
+    res->handler = response->handler;
+    res->elasticity = response->elasticity;
+    res->collided_before = false;
+    res->separating_axis = (Vector) {0, 0};
+    return res;
+}
+
+
+void collision_response_free(collision_response *response) {
+    if (response->freer != NULL && response->aux_val != NULL) {
+        response->freer(response->aux_val);
+    }
+    free(response);
+}
+
+
+// Adds a category collision, run by either collision_creator()
+// or physics_creator()
+void add_category_collision(Scene *scene, uint32_t category1,
+    uint32_t category2, ForceCreator forcer, CollisionHandler handler,
+    void *aux, double elasticity, FreeFunc freer) {
+    assert(scene != NULL);
+    collision_response *response = malloc(sizeof(collision_response));
+    assert(response != NULL);
+    response->scene = scene;
+    response->handler = handler;
+    response->aux_val = aux;
+    response->freer = freer;
+    response->elasticity = elasticity;
+
+    scene_add_category_response(scene, category1, category2,
+        forcer, (PairTest) collision_test,
+        (PairAuxInit) collision_info_init, (FreeFunc) free, response,
+        (FreeFunc) collision_response_free);
+}
+
+
+void create_category_collision(Scene *scene, uint32_t category1,
+    uint32_t category2, CollisionHandler handler, void *aux, FreeFunc freer) {
+    add_category_collision(scene, category1, category2,
+        (ForceCreator) collision_creator, handler, aux, 0, freer);
 }
 
 
@@ -282,11 +508,14 @@ void create_physics_collision( Scene *scene, double elasticity, Body *body1,
 
 {
     assert(scene != NULL && body1 != NULL && body2 != NULL);
-    double *aux = malloc(sizeof(double));
-    assert(aux != NULL);
-    *aux = elasticity;
+    add_collision(scene, body1, body2, (ForceCreator) physics_creator,
+        NULL, NULL, elasticity, (FreeFunc) free);
+
+}
 
-    create_collision(scene, body1, body2, 
-        (CollisionHandler) physics_collision_handler, aux, (FreeFunc) free);
 
+void create_category_physics_collision(Scene *scene, double elasticity,
+    uint32_t category1, uint32_t category2) {
+    add_category_collision(scene, category1, category2,
+        (ForceCreator) physics_creator, NULL, NULL, elasticity, NULL);
 }
@@ -0,0 +1,304 @@
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include "gjk.h"
+
+// Upper bound on GJK iterations; it normally finishes in a handful
+#define GJK_MAX_ITERATIONS 32
+// Upper bound on EPA iterations, which also bounds the polytope's size
+#define EPA_MAX_ITERATIONS 32
+// EPA stops once a new support point improves the depth by less than this
+#define EPA_TOLERANCE 1e-9
+
+/**
+ * The pair of shapes GJK is running on.
+ * The hints remember where each shape's last support point was,
+ * since consecutive search directions are usually close together.
+ */
+typedef struct {
+    Polygon *shape1;
+    Polygon *shape2;
+    size_t hint1;
+    size_t hint2;
+} gjk_pair;
+
+// Finds the support point by checking every vertex
+size_t polygon_support_scan(Polygon *shape, Vector direction) {
+    size_t best = 0;
+    double best_dot = vec_dot(shape->vertices[0], direction);
+    for (size_t i = 1; i < shape->size; i++) {
+        double dot = vec_dot(shape->vertices[i], direction);
+        if (dot > best_dot) {
+            best = i;
+            best_dot = dot;
+        }
+    }
+    return best;
+}
+
+size_t polygon_support(Polygon *shape, Vector direction, size_t start) {
+    assert(shape != NULL && shape->size > 0 && start < shape->size);
+    size_t size = shape->size;
+    Vector *vertices = shape->vertices;
+    size_t best = start;
+    double best_dot = vec_dot(vertices[best], direction);
+
+    // On a convex polygon, the projections rise monotonically towards the
+    // support point, so whichever neighbor is further along leads to it
+    size_t after = best + 1 == size ? 0 : best + 1;
+    size_t before = best == 0 ? size - 1 : best - 1;
+    double after_dot = vec_dot(vertices[after], direction);
+    double before_dot = vec_dot(vertices[before], direction);
+    size_t next = after;
+    size_t step = 1;
+    if (after_dot <= best_dot) {
+        if (before_dot < best_dot || (before_dot == best_dot
+                && after_dot < best_dot)) {
+            // Both neighbors are behind, or one is and the other is on
+            // the same face perpendicular to direction: this is the support
+            return best;
+        }
+        if (before_dot == best_dot) {
+            // Both neighbors tie, so start is inside a run of collinear
+            // vertices perpendicular to direction. That may be the face
+            // furthest along or the one furthest back, so check them all.
+            return polygon_support_scan(shape, direction);
+        }
+        next = before;
+        step = size - 1;
+    }
+
+    for (size_t i = 1; i < size; i++) {
+        double next_dot = vec_dot(vertices[next], direction);
+        if (next_dot <= best_dot) {
+            break;
+        }
+        best = next;
+        best_dot = next_dot;
+        next = (next + step) % size;
+    }
+    return best;
+}
+
+// Returns the support point of the Minkowski difference shape1 - shape2
+Vector gjk_support(gjk_pair *pair, Vector direction) {
+    pair->hint1 = polygon_support(pair->shape1, direction, pair->hint1);
+    pair->hint2 = polygon_support(pair->shape2, vec_negate(direction),
+        pair->hint2);
+    return vec_subtract(pair->shape1->vertices[pair->hint1],
+        pair->shape2->vertices[pair->hint2]);
+}
+
+// Returns (a x b) x c, which for a == c is the part of b perpendicular to a
+Vector triple_product(Vector a, Vector b, Vector c) {
+    return vec_subtract(vec_multiply(vec_dot(a, c), b),
+        vec_multiply(vec_dot(b, c), a));
+}
+
+/**
+ * Updates the simplex to the part closest to the origin
+ * and picks the next search direction.
+ * The newest point is last.
+ *
+ * @return whether the simplex contains the origin
+ */
+bool gjk_update_simplex(Vector *simplex, size_t *count, Vector *direction) {
+    Vector a = simplex[*count - 1];
+    Vector ao = vec_negate(a);
+
+    if (*count == 2) {
+        Vector ab = vec_subtract(simplex[0], a);
+        *direction = triple_product(ab, ao, ab);
+        // The origin lies on the segment
+        return vec_dot(*direction, *direction) == 0;
+    }
+
+    Vector b = simplex[1];
+    Vector c = simplex[0];
+    Vector ab = vec_subtract(b, a);
+    Vector ac = vec_subtract(c, a);
+    Vector ab_perp = triple_product(ac, ab, ab);
+    Vector ac_perp = triple_product(ab, ac, ac);
+
+    if (vec_dot(ab_perp, ao) > 0) {
+        // The origin is past edge ab; drop c
+        simplex[0] = b;
+        simplex[1] = a;
+        *count = 2;
+        *direction = ab_perp;
+        return false;
+    }
+    if (vec_dot(ac_perp, ao) > 0) {
+        // The origin is past edge ac; drop b
+        simplex[1] = a;
+        *count = 2;
+        *direction = ac_perp;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * An edge of the EPA polytope, from polytope[i] to polytope[i + 1].
+ * Kept alongside the vertices so each iteration only has to compute
+ * the two edges it creates.
+ */
+typedef struct {
+    Vector normal; // outward unit normal
+    double distance; // distance from the origin to the edge's line
+} epa_edge;
+
+epa_edge epa_edge_init(Vector start, Vector end) {
+    Vector edge = vec_subtract(end, start);
+    double length = sqrt(vec_dot(edge, edge));
+    if (length == 0) {
+        // A repeated vertex is never the closest edge
+        return (epa_edge) {.normal = {0, 0}, .distance = DBL_MAX};
+    }
+    Vector normal = {edge.y / length, -edge.x / length};
+    return (epa_edge) {.normal = normal, .distance = vec_dot(normal, start)};
+}
+
+/**
+ * Expands a simplex containing the origin towards the boundary of the
+ * Minkowski difference to find the penetration axis and depth.
+ */
+CollisionInfo epa(gjk_pair *pair, Vector *simplex) {
+    Vector polytope[3 + EPA_MAX_ITERATIONS];
+    epa_edge edges[3 + EPA_MAX_ITERATIONS];
+    size_t count = 3;
+    for (size_t i = 0; i < 3; i++) {
+        polytope[i] = simplex[i];
+    }
+
+    // Orient edges so (e.y, -e.x) points outwards
+    double area = vec_cross(vec_subtract(polytope[1], polytope[0]),
+        vec_subtract(polytope[2], polytope[0]));
+    if (area < 0) {
+        Vector tmp = polytope[1];
+        polytope[1] = polytope[2];
+        polytope[2] = tmp;
+    }
+    for (size_t i = 0; i < 3; i++) {
+        edges[i] = epa_edge_init(polytope[i], polytope[(i + 1) % 3]);
+    }
+
+    size_t closest;
+    while (true) {
+        closest = 0;
+        for (size_t i = 1; i < count; i++) {
+            if (edges[i].distance < edges[closest].distance) {
+                closest = i;
+            }
+        }
+
+        Vector axis = edges[closest].normal;
+        Vector point = gjk_support(pair, axis);
+        if (vec_dot(point, axis) - edges[closest].distance < EPA_TOLERANCE
+            || count == 3 + EPA_MAX_ITERATIONS) {
+            break;
+        }
+
+        // Split the closest edge at the new support point
+        for (size_t i = count; i > closest + 1; i--) {
+            polytope[i] = polytope[i - 1];
+            edges[i] = edges[i - 1];
+        }
+        polytope[closest + 1] = point;
+        count++;
+        edges[closest] = epa_edge_init(polytope[closest], point);
+        edges[closest + 1] = epa_edge_init(point,
+            polytope[closest + 2 == count ? 0 : closest + 2]);
+    }
+
+    // Moving shape1 by -depth * axis separates the shapes,
+    // so axis points from shape1 towards shape2
+    return (CollisionInfo) {.collided = true, .axis = edges[closest].normal,
+        .min_overlap = edges[closest].distance};
+}
+
+/**
+ * Picks the axis for shapes that just touch, i.e. when the origin lies on
+ * the boundary of shape1 - shape2 and the simplex is a point or segment.
+ * The axis is the side of the simplex's perpendicular that the
+ * Minkowski difference does not extend past.
+ */
+CollisionInfo gjk_touching(gjk_pair *pair, Vector *simplex, size_t count,
+    Vector direction) {
+    Vector perp = direction;
+    if (count == 2) {
+        Vector edge = vec_subtract(simplex[1], simplex[0]);
+        perp = (Vector) {-edge.y, edge.x};
+    }
+    if (perp.x == 0 && perp.y == 0) {
+        perp = (Vector) {1, 0};
+    }
+    perp = vec_normalize(perp);
+
+    double reach = vec_dot(gjk_support(pair, perp), perp);
+    double back_reach = -vec_dot(gjk_support(pair, vec_negate(perp)), perp);
+    Vector axis = reach <= back_reach ? perp : vec_negate(perp);
+    return (CollisionInfo) {.collided = true, .axis = axis, .min_overlap = 0};
+}
+
+/**
+ * Runs SAT on the shapes, flipping the axis if needed so it points from
+ * shape1 towards shape2 like GJK's.
+ */
+CollisionInfo find_collision_sat_oriented(Polygon *shape1, Polygon *shape2) {
+    CollisionInfo res = find_collision_packed(shape1, shape2);
+    if (!res.collided) {
+        return res;
+    }
+    Projection p1 = project_vertices(shape1->vertices, shape1->size,
+        res.axis);
+    Projection p2 = project_vertices(shape2->vertices, shape2->size,
+        res.axis);
+    if (p2.min + p2.max < p1.min + p1.max) {
+        res.axis = vec_negate(res.axis);
+    }
+    return res;
+}
+
+CollisionInfo find_collision_gjk(Polygon *shape1, Polygon *shape2) {
+    assert(shape1 != NULL && shape2 != NULL);
+    CollisionInfo none = {.collided = false, .axis = {0, 0}, .min_overlap = 0};
+    gjk_pair pair = {.shape1 = shape1, .shape2 = shape2, .hint1 = 0,
+        .hint2 = 0};
+
+    Vector direction = vec_subtract(shape2->vertices[0], shape1->vertices[0]);
+    if (direction.x == 0 && direction.y == 0) {
+        direction = (Vector) {1, 0};
+    }
+
+    Vector start = direction;
+    Vector simplex[3];
+    size_t count = 1;
+    simplex[0] = gjk_support(&pair, direction);
+    direction = vec_negate(simplex[0]);
+
+    for (size_t i = 0; i < GJK_MAX_ITERATIONS; i++) {
+        if (direction.x == 0 && direction.y == 0) {
+            // The origin is on the simplex, so the shapes just touch
+            return gjk_touching(&pair, simplex, count, start);
+        }
+
+        Vector point = gjk_support(&pair, direction);
+        if (vec_dot(point, direction) < 0) {
+            // No point of shape1 - shape2 reaches the origin along direction,
+            // so it separates the shapes
+            none.axis = vec_normalize(direction);
+            return none;
+        }
+
+        simplex[count++] = point;
+        if (gjk_update_simplex(simplex, &count, &direction)) {
+            return count < 3 ? gjk_touching(&pair, simplex, count, start)
+                : epa(&pair, simplex);
+        }
+    }
+
+    // Did not converge, which only happens for degenerate shapes.
+    // SAT does not depend on the search, so let it decide.
+    return find_collision_sat_oriented(shape1, shape2);
+}
@@ -51,16 +51,36 @@ void *list_get(List *list, size_t index) {
 void *list_remove(List *list, size_t index) {
     assert(list != NULL && index < list->size);
 
-    size_t size = list_size(list);
     void *res = list->data[index];
-    void **tmp = calloc(size - index - 1, sizeof(void *));
-    memcpy(tmp, list->data + index + 1, (size - index - 1) * sizeof(void *));
-    memcpy(list->data + index, tmp, (size - index - 1) * sizeof(void *));
+    memmove(list->data + index, list->data + index + 1,
+        (list->size - index - 1) * sizeof(void *));
     list->size--;
-    free(tmp);
     return res;
 }
 
+void *list_swap_remove(List *list, size_t index) {
+    assert(list != NULL && index < list->size);
+
+    void *res = list->data[index];
+    list->data[index] = list->data[--list->size];
+    return res;
+}
+
+size_t list_remove_if(List *list, ListPredicate pred, void *aux) {
+    assert(list != NULL && pred != NULL);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < list->size; i++) {
+        if (!pred(list->data[i], aux)) {
+            list->data[kept++] = list->data[i];
+        }
+    }
+
+    size_t removed = list->size - kept;
+    list->size = kept;
+    return removed;
+}
+
 void list_add(List *list, void *value) {
     assert(list != NULL && value != NULL);
     size_t size = list_size(list);
@@ -73,3 +93,15 @@ void list_add(List *list, void *value) {
 
     list->data[list->size++] = value;
 }
+
+void list_clear(List *list) {
+    assert(list != NULL);
+
+    if (list->free != NULL) {
+        for (size_t i = 0; i < list->size; i++) {
+            list->free(list->data[i]);
+        }
+    }
+
+    list->size = 0;
+}
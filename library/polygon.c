@@ -1,5 +1,11 @@
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
 #include "polygon.h"
 
+// Unit normals whose cross product is smaller than this count as parallel
+#define PARALLEL_EPSILON 1e-9
+
 double polygon_area(List *polygon) {
     size_t size = list_size(polygon);
     double area = 0;
@@ -70,3 +76,131 @@ void polygon_rotate(List *polygon, double angle, Vector point) {
         tmp->y = new_vec.y;
     }
 }
+
+Polygon *polygon_init(size_t size) {
+    Polygon *res = calloc(1, sizeof(Polygon) + size * sizeof(Vector));
+    assert(res != NULL);
+    res->size = size;
+    return res;
+}
+
+Polygon *polygon_from_list(List *polygon) {
+    size_t size = list_size(polygon);
+    Polygon *res = polygon_init(size);
+
+    for (size_t i = 0; i < size; i++) {
+        res->vertices[i] = *(Vector *) list_get(polygon, i);
+    }
+
+    return res;
+}
+
+List *polygon_to_list(Polygon *polygon) {
+    List *res = list_init(polygon->size, (FreeFunc) vec_free);
+
+    for (size_t i = 0; i < polygon->size; i++) {
+        Vector vertex = polygon->vertices[i];
+        list_add(res, vec_init(vertex.x, vertex.y));
+    }
+
+    return res;
+}
+
+void polygon_free(Polygon *polygon) {
+    free(polygon);
+}
+
+double polygon_area_packed(Polygon *polygon) {
+    size_t size = polygon->size;
+    Vector *vertices = polygon->vertices;
+    double area = 0;
+
+    for (size_t i = 0; i < size; i++) {
+        Vector curr = vertices[i];
+        Vector next = vertices[i + 1 == size ? 0 : i + 1];
+        area += curr.x * next.y - next.x * curr.y;
+    }
+
+    return area / 2;
+}
+
+Vector polygon_centroid_packed(Polygon *polygon) {
+    size_t size = polygon->size;
+    Vector *vertices = polygon->vertices;
+    double area = polygon_area_packed(polygon);
+    Vector res = {.x = 0, .y = 0};
+
+    for (size_t i = 0; i < size; i++) {
+        Vector curr = vertices[i];
+        Vector next = vertices[i + 1 == size ? 0 : i + 1];
+        double tmp = curr.x * next.y - curr.y * next.x;
+        res.x += (curr.x + next.x) * tmp;
+        res.y += (curr.y + next.y) * tmp;
+    }
+
+    res.x /= 6 * area;
+    res.y /= 6 * area;
+    return res;
+}
+
+void polygon_translate_packed(Polygon *polygon, Vector translation) {
+    for (size_t i = 0; i < polygon->size; i++) {
+        polygon->vertices[i].x += translation.x;
+        polygon->vertices[i].y += translation.y;
+    }
+}
+
+void polygon_rotate_packed(Polygon *polygon, double angle, Vector point) {
+    double cos_angle = cos(angle);
+    double sin_angle = sin(angle);
+
+    for (size_t i = 0; i < polygon->size; i++) {
+        double x = polygon->vertices[i].x - point.x;
+        double y = polygon->vertices[i].y - point.y;
+        polygon->vertices[i].x = x * cos_angle - y * sin_angle + point.x;
+        polygon->vertices[i].y = x * sin_angle + y * cos_angle + point.y;
+    }
+}
+
+Polygon *polygon_edge_normals(Polygon *polygon) {
+    size_t size = polygon->size;
+    Vector *vertices = polygon->vertices;
+    Polygon *res = polygon_init(size);
+    size_t count = 0;
+
+    for (size_t i = 0; i < size; i++) {
+        Vector edge = vec_subtract(vertices[i + 1 == size ? 0 : i + 1],
+            vertices[i]);
+        Vector normal = vec_normalize(vec_norm(edge));
+        bool parallel = false;
+
+        for (size_t j = 0; j < count && !parallel; j++) {
+            parallel = fabs(vec_cross(normal, res->vertices[j]))
+                < PARALLEL_EPSILON;
+        }
+        if (!parallel) {
+            res->vertices[count++] = normal;
+        }
+    }
+
+    res->size = count;
+    return res;
+}
+
+bool polygon_is_convex(Polygon *polygon) {
+    size_t size = polygon->size;
+    Vector *vertices = polygon->vertices;
+    bool left = false;
+    bool right = false;
+
+    for (size_t i = 0; i < size; i++) {
+        Vector v1 = vertices[i];
+        Vector v2 = vertices[(i + 1) % size];
+        Vector v3 = vertices[(i + 2) % size];
+        double turn = vec_cross(vec_subtract(v2, v1), vec_subtract(v3, v2));
+        left = left || turn > 0;
+        right = right || turn < 0;
+    }
+
+    return !(left && right);
+}
@@ -1,5 +1,20 @@
+#include <assert.h>
+#include <pthread.h>
 #include "projection.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define HAVE_SSE2 1
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_AVX2 1
+#endif
+
+// The kernels load vertices as pairs of doubles
+_Static_assert(sizeof(Vector) == 2 * sizeof(double), "Vector must be packed");
+
 bool overlaps(Projection p1, Projection p2) {
     return !(p1.min > p2.max || p1.max < p2.min);
 }
@@ -8,3 +23,160 @@ bool overlaps(Projection p1, Projection p2) {
 double getOverlap(Projection p1, Projection p2) {
 	return (MIN_(p1.max, p2.max) - MAX_(p1.min, p2.min));
 }
+
+
+Projection project_vertices_scalar(const Vector *vertices, size_t count,
+    Vector axis) {
+    double min = vec_dot(vertices[0], axis);
+    double max = min;
+
+    for (size_t i = 1; i < count; i++) {
+        double p = vec_dot(vertices[i], axis);
+
+        if (p < min) {
+            min = p;
+        } else if (p > max) {
+            max = p;
+        }
+    }
+    return (Projection) {.min = min, .max = max};
+}
+
+#ifdef HAVE_SSE2
+// Projects two vertices per iteration.
+// Each dot product is x * axis.x + y * axis.y, as in vec_dot(),
+// so the results match the scalar version exactly.
+Projection project_vertices_sse2(const Vector *vertices, size_t count,
+    Vector axis) {
+    const double *data = (const double *) vertices;
+    __m128d axis_x = _mm_set1_pd(axis.x);
+    __m128d axis_y = _mm_set1_pd(axis.y);
+    double first = vec_dot(vertices[0], axis);
+    __m128d min = _mm_set1_pd(first);
+    __m128d max = min;
+    size_t i = 0;
+
+    for (; i + 2 <= count; i += 2) {
+        __m128d v0 = _mm_loadu_pd(data + 2 * i);
+        __m128d v1 = _mm_loadu_pd(data + 2 * i + 2);
+        __m128d xs = _mm_unpacklo_pd(v0, v1);
+        __m128d ys = _mm_unpackhi_pd(v0, v1);
+        __m128d p = _mm_add_pd(_mm_mul_pd(xs, axis_x), _mm_mul_pd(ys, axis_y));
+        min = _mm_min_pd(min, p);
+        max = _mm_max_pd(max, p);
+    }
+
+    double mins[2], maxs[2];
+    _mm_storeu_pd(mins, min);
+    _mm_storeu_pd(maxs, max);
+    Projection res = {.min = MIN_(mins[0], mins[1]),
+        .max = MAX_(maxs[0], maxs[1])};
+
+    for (; i < count; i++) {
+        double p = vec_dot(vertices[i], axis);
+        res.min = MIN_(res.min, p);
+        res.max = MAX_(res.max, p);
+    }
+    return res;
+}
+#endif
+
+#ifdef HAVE_AVX2
+// Same as project_vertices_sse2(), four vertices per iteration.
+// Only called after checking that the CPU supports AVX2.
+__attribute__((target("avx2")))
+Projection project_vertices_avx2(const Vector *vertices, size_t count,
+    Vector axis) {
+    const double *data = (const double *) vertices;
+    __m256d axis_x = _mm256_set1_pd(axis.x);
+    __m256d axis_y = _mm256_set1_pd(axis.y);
+    double first = vertices[0].x * axis.x + vertices[0].y * axis.y;
+    __m256d min = _mm256_set1_pd(first);
+    __m256d max = min;
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        // (x0, y0, x1, y1) and (x2, y2, x3, y3)
+        __m256d v01 = _mm256_loadu_pd(data + 2 * i);
+        __m256d v23 = _mm256_loadu_pd(data + 2 * i + 4);
+        // (x0, x2, x1, x3) and (y0, y2, y1, y3); the order does not matter
+        __m256d xs = _mm256_unpacklo_pd(v01, v23);
+        __m256d ys = _mm256_unpackhi_pd(v01, v23);
+        __m256d p = _mm256_add_pd(_mm256_mul_pd(xs, axis_x),
+            _mm256_mul_pd(ys, axis_y));
+        min = _mm256_min_pd(min, p);
+        max = _mm256_max_pd(max, p);
+    }
+
+    double mins[4], maxs[4];
+    _mm256_storeu_pd(mins, min);
+    _mm256_storeu_pd(maxs, max);
+    Projection res = {
+        .min = MIN_(MIN_(mins[0], mins[1]), MIN_(mins[2], mins[3])),
+        .max = MAX_(MAX_(maxs[0], maxs[1]), MAX_(maxs[2], maxs[3]))
+    };
+
+    for (; i < count; i++) {
+        double p = vertices[i].x * axis.x + vertices[i].y * axis.y;
+        res.min = MIN_(res.min, p);
+        res.max = MAX_(res.max, p);
+    }
+    return res;
+}
+#endif
+
+// Picks the widest kernel the CPU supports
+ProjectionKernel select_projection_kernel(void) {
+#ifdef HAVE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return project_vertices_avx2;
+    }
+#endif
+#ifdef HAVE_SSE2
+    return project_vertices_sse2;
+#else
+    return project_vertices_scalar;
+#endif
+}
+
+ProjectionKernel projection_get_kernel(ProjectionKernelType type) {
+    switch (type) {
+    case PROJECTION_SCALAR:
+        return project_vertices_scalar;
+    case PROJECTION_SSE2:
+#ifdef HAVE_SSE2
+        return project_vertices_sse2;
+#else
+        return NULL;
+#endif
+    case PROJECTION_AVX2:
+#ifdef HAVE_AVX2
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") ? project_vertices_avx2 : NULL;
+#else
+        return NULL;
+#endif
+    }
+    return NULL;
+}
+
+/**
+ * The kernel used by project_vertices(), or NULL before the first call.
+ * The first calls may come from several of a scene's worker threads at
+ * once, so it is set through pthread_once().
+ */
+ProjectionKernel projection_kernel = NULL;
+pthread_once_t projection_kernel_once = PTHREAD_ONCE_INIT;
+
+void init_projection_kernel(void) {
+    projection_kernel = select_projection_kernel();
+}
+
+Projection project_vertices(const Vector *vertices, size_t count,
+    Vector axis) {
+    assert(vertices != NULL && count > 0);
+
+    pthread_once(&projection_kernel_once, init_projection_kernel);
+    return projection_kernel(vertices, count, axis);
+}
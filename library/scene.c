@@ -1,73 +1,182 @@
+#include <stdint.h>
 #include "scene.h"
 #include "sdl_wrapper.h"
+#include "thread_pool.h"
 
 #define INIT_SIZE 10
+#define DEFAULT_CELL_SIZE 250
+#define DEFAULT_TREE_MARGIN 25
+#define INIT_PAIR_BUCKETS 64
+#define FRAME_ARENA_SIZE 16384
+#define INC_FACTOR 2
+#define PAIR_TEST_GRAIN 16
+#define REFRESH_GRAIN 64
+#define DEFAULT_CONTACT_ITERATIONS 4
 
 /**
  * force_creator_info struct to hold information about a force creator.
  *
- * @param forcer ForceCreator function to by called from scene_tick().
- * @param aux    auxilary value to pass to forcer.
- * @param freer  function to free aux.
- * @param bodies a list of bodies that this is applied to.
+ * @param forcer    ForceCreator function to by called from scene_tick().
+ * @param test      narrowphase test to run before a pair creator, if any.
+ * @param aux       auxilary value to pass to forcer.
+ * @param freer     function to free aux.
+ * @param bodies    handles to the bodies that this is applied to.
+ * @param is_pair   whether forcer is only called for nearby pairs of bodies.
+ * @param near_tick the last tick on which a pair creator's bodies were near.
+ * @param next_pair the next pair creator in the same bucket of the pair index.
+ * @param response  the category response that added this pair creator, if any.
+ * @param dead      whether one of its bodies has been removed, or it was
+ *                  added by a category response and its bodies separated.
+ *                  Dead creators are never invoked, and their aux is freed.
+ * @param refs      the number of places still pointing at this struct:
+ *                  the creator lists of its bodies, plus the scene's
+ *                  force_creators or pair index until it dies.
  */
-typedef struct {
+typedef struct force_creator_info {
     ForceCreator forcer;
+    PairTest test;
     void *aux;
     FreeFunc freer;
-    List *bodies;
+    BodyHandleArray bodies;
+    bool is_pair;
+    size_t near_tick;
+    struct force_creator_info *next_pair;
+    struct category_response *response;
+    bool dead;
+    size_t refs;
 } force_creator_info;
 
+ARRAY_DEFINE(ForceCreatorArray, force_creator_info *, creator_array)
+
 /**
- * @param bodies         a list of bodies in the scene.
- * @param force_creators a list of force_creator_info's.
+ * A response registered with scene_add_category_response().
+ *
+ * @param category1  the categories the first body of a pair must share.
+ * @param category2  the categories the second body of a pair must share.
+ * @param forcer     the force creator to add between each pair.
+ * @param test       the narrowphase test of each pair's force creator.
+ * @param aux_init   makes the auxiliary value of each pair's force creator.
+ * @param pair_freer frees the auxiliary value of each pair's force creator.
+ * @param aux        auxilary value to pass to aux_init.
+ * @param freer      function to free aux.
+ */
+typedef struct category_response {
+    uint32_t category1;
+    uint32_t category2;
+    ForceCreator forcer;
+    PairTest test;
+    PairAuxInit aux_init;
+    FreeFunc pair_freer;
+    void *aux;
+    FreeFunc freer;
+} category_response;
+
+ARRAY_DEFINE(ResponseArray, category_response *, response_array)
+ARRAY_DEFINE(CollisionEventArray, CollisionEvent, collision_event_array)
+
+/**
+ * @param bodies            the bodies in the scene.
+ * @param force_creators    the force creators invoked on every tick,
+ *                          in the order they were added.
+ * @param broadphase        the algorithm used to find nearby bodies.
+ * @param grid              the spatial hash broadphase.
+ * @param sweep             the sweep-and-prune broadphase, if it is in use.
+ * @param tree              the AABB tree broadphase, if it is in use.
+ * @param pair_buckets      the pair creators, hashed by their two bodies.
+ * @param pair_bucket_count the number of buckets, always a power of two.
+ * @param pair_count        the number of pair creators.
+ * @param near_pairs        the pair creators called on the current tick.
+ * @param prev_near_pairs   the pair creators called on the previous tick.
+ * @param separated_pairs   the pair creators getting their last call
+ *                          on the current tick.
+ * @param tick              the number of ticks executed so far.
+ * @param frame_arena       scratch memory, reset at the start of each tick.
+ * @param responses         the category responses of the scene.
+ * @param body_creators     the force creators of each body, by pool slot.
+ * @param body_slots        the number of lists in body_creators.
+ * @param has_dead_creators whether force_creators holds dead creators.
+ * @param pool              the threads the tick phases share work between,
+ *                          if any.
+ * @param narrowphase       the tasks of the narrowphase, when there is a pool.
+ * @param events            the collision events of the current tick,
+ *                          in the order they were queued.
+ * @param contacts          the contacts of the current and previous ticks.
+ * @param contact_iterations the number of passes over lasting contacts.
  */
 struct scene {
-    List *bodies;
-    List *force_creators;
+    BodyArray bodies;
+    ForceCreatorArray force_creators;
+    BroadphaseType broadphase;
+    SpatialHash *grid;
+    SweepAndPrune *sweep;
+    AABBTree *tree;
+    force_creator_info **pair_buckets;
+    size_t pair_bucket_count;
+    size_t pair_count;
+    ForceCreatorArray near_pairs;
+    ForceCreatorArray prev_near_pairs;
+    ForceCreatorArray separated_pairs;
+    size_t tick;
+    Arena *frame_arena;
+    ResponseArray responses;
+    ForceCreatorArray *body_creators;
+    size_t body_slots;
+    bool has_dead_creators;
+    ThreadPool *pool;
+    TaskGraph *narrowphase;
+    CollisionEventArray events;
+    ContactCache *contacts;
+    size_t contact_iterations;
 };
 
 Scene *scene_init(void) {
     Scene *res = malloc(sizeof(Scene));
     assert(res != NULL);
-    res->bodies = list_init(INIT_SIZE, (FreeFunc) body_free);
-    res->force_creators = list_init(INIT_SIZE, (FreeFunc) free);
+    body_array_init(&res->bodies, INIT_SIZE);
+    creator_array_init(&res->force_creators, INIT_SIZE);
+    res->broadphase = BROADPHASE_SPATIAL_HASH;
+    res->grid = spatial_hash_init(DEFAULT_CELL_SIZE);
+    res->sweep = NULL;
+    res->tree = NULL;
+    res->pair_buckets = calloc(INIT_PAIR_BUCKETS, sizeof(force_creator_info *));
+    assert(res->pair_buckets != NULL);
+    res->pair_bucket_count = INIT_PAIR_BUCKETS;
+    res->pair_count = 0;
+    creator_array_init(&res->near_pairs, INIT_SIZE);
+    creator_array_init(&res->prev_near_pairs, INIT_SIZE);
+    creator_array_init(&res->separated_pairs, INIT_SIZE);
+    res->tick = 0;
+    res->frame_arena = arena_init(FRAME_ARENA_SIZE);
+    response_array_init(&res->responses, INIT_SIZE);
+    res->body_creators = NULL;
+    res->body_slots = 0;
+    res->has_dead_creators = false;
+    res->pool = NULL;
+    res->narrowphase = NULL;
+    collision_event_array_init(&res->events, INIT_SIZE);
+    res->contacts = contact_cache_init();
+    res->contact_iterations = DEFAULT_CONTACT_ITERATIONS;
     return res;
 }
 
-void scene_free(Scene *scene) {
-    assert(scene != NULL);
-    list_free(scene->bodies);
-
-    for (size_t i = 0; i < list_size(scene->force_creators); i++) {
-        force_creator_info *tmp = list_get(scene->force_creators, i);
-        if (tmp->freer != NULL && tmp->aux != NULL) {
-            tmp->freer(tmp->aux);
-        }
-
-    }
-    list_free(scene->force_creators);
-    free(scene);
-}
-
 size_t scene_bodies(Scene *scene) {
     assert(scene != NULL);
-    return list_size(scene->bodies);
+    return scene->bodies.size;
 }
 
 Body *scene_get_body(Scene *scene, size_t index) {
     assert(scene != NULL && index < scene_bodies(scene));
-    return list_get(scene->bodies, index);
+    return body_array_get(&scene->bodies, index);
 }
 
 void scene_add_body(Scene *scene, Body *body) {
     assert(scene != NULL && body != NULL);
-    list_add(scene->bodies, body);
+    body_array_add(&scene->bodies, body);
 }
 
 void scene_remove_body(Scene *scene, size_t index) {
     assert(scene != NULL);
-    body_remove(list_get(scene->bodies, index));
+    body_remove(body_array_get(&scene->bodies, index));
     // body_free(list_remove(scene->bodies, index));
 }
 
@@ -76,6 +185,94 @@ void scene_add_force_creator(Scene *scene, ForceCreator forcer,
     scene_add_bodies_force_creator(scene, forcer, aux, list_init(10, free), freer);
 }
 
+// Drops one reference to a force creator, freeing it after the last one
+void release_creator(force_creator_info *info) {
+    assert(info->refs > 0);
+    info->refs--;
+    if (info->refs == 0) {
+        assert(info->dead);
+        free(info);
+    }
+}
+
+// Releases a body's references to dead creators, keeping the rest in order
+bool release_if_dead(force_creator_info *info, void *aux) {
+    if (!info->dead) {
+        return false;
+    }
+    release_creator(info);
+    return true;
+}
+
+// Records that a force creator acts on a body, so it dies with the body
+void add_body_creator(Scene *scene, BodyHandle body,
+    force_creator_info *info) {
+    if (body.index >= scene->body_slots) {
+        size_t slots = scene->body_slots == 0 ? INIT_SIZE : scene->body_slots;
+        while (slots <= body.index) {
+            slots *= INC_FACTOR;
+        }
+        scene->body_creators = realloc(scene->body_creators,
+            slots * sizeof(ForceCreatorArray));
+        assert(scene->body_creators != NULL);
+        for (size_t i = scene->body_slots; i < slots; i++) {
+            creator_array_init(&scene->body_creators[i], 1);
+        }
+        scene->body_slots = slots;
+    }
+
+    ForceCreatorArray *creators = &scene->body_creators[body.index];
+    // Creators that died with the body's partners are dropped lazily,
+    // which keeps long-lived bodies' lists from growing without bound
+    if (creators->size == creators->capacity) {
+        creator_array_remove_if(creators, release_if_dead, NULL);
+    }
+    creator_array_add(creators, info);
+    info->refs++;
+}
+
+// Creates a force creator with room for body_count bodies, but none yet
+force_creator_info *new_force_creator(
+    Scene *scene, ForceCreator forcer, void *aux, FreeFunc freer,
+    size_t body_count
+) {
+    assert(scene != NULL);
+    force_creator_info *res = malloc(sizeof(force_creator_info));
+    assert(res != NULL);
+    res->forcer = forcer;
+    res->test = NULL;
+    res->aux = aux;
+    res->freer = freer;
+    body_handle_array_init(&res->bodies, body_count);
+    res->is_pair = false;
+    res->near_tick = 0;
+    res->next_pair = NULL;
+    res->response = NULL;
+    res->dead = false;
+    // The reference from force_creators or the pair index
+    res->refs = 1;
+    return res;
+}
+
+// Adds a body to a force creator and to the body's list of creators
+void add_creator_body(Scene *scene, force_creator_info *info,
+    BodyHandle body) {
+    body_handle_array_add(&info->bodies, body);
+    add_body_creator(scene, body, info);
+}
+
+force_creator_info *add_force_creator(
+    Scene *scene, ForceCreator forcer, void *aux, List *bodies, FreeFunc freer
+) {
+    force_creator_info *res = new_force_creator(scene, forcer, aux, freer,
+        list_size(bodies));
+    for (size_t i = 0; i < list_size(bodies); i++) {
+        add_creator_body(scene, res, body_get_handle(list_get(bodies, i)));
+    }
+    list_free(bodies);
+    return res;
+}
+
 /**
  * Adds a force creator to a scene,
  * to be invoked every time scene_tick() is called.
@@ -89,99 +286,855 @@ void scene_add_force_creator(Scene *scene, ForceCreator forcer,
  * @param bodies the list of bodies affected by the force creator.
  *   The force creator will be removed if any of these bodies are removed.
  *   This list does not own the bodies, so its freer should be NULL.
+ *   The scene copies the bodies out of the list and then frees it.
  * @param freer if non-NULL, a function to call in order to free aux
  */
 void scene_add_bodies_force_creator(
     Scene *scene, ForceCreator forcer, void *aux, List *bodies, FreeFunc freer
 ) {
+    creator_array_add(&scene->force_creators,
+        add_force_creator(scene, forcer, aux, bodies, freer));
+}
+
+void *scene_find_force_creator(Scene *scene, ForceCreator forcer) {
     assert(scene != NULL);
-    force_creator_info *res = malloc(sizeof(force_creator_info));
+    for (size_t i = 0; i < scene->force_creators.size; i++) {
+        force_creator_info *tmp = ARRAY_AT(&scene->force_creators, i);
+        if (tmp->forcer == forcer && !tmp->dead) {
+            return tmp->aux;
+        }
+    }
+    return NULL;
+}
+
+// Returns the bucket of the pair index holding creators between two bodies.
+// The hash is symmetric, so the order of the bodies does not matter.
+// It only uses the bodies' pool slots, so it still works once one is freed.
+size_t pair_bucket(Scene *scene, BodyHandle body1, BodyHandle body2) {
+    uint64_t lo = body1.index < body2.index ? body1.index : body2.index;
+    uint64_t hi = body1.index < body2.index ? body2.index : body1.index;
+    uint64_t h = ((hi << 32) | lo) * 0x9E3779B97F4A7C15u;
+    return (size_t) (h >> 32) & (scene->pair_bucket_count - 1);
+}
+
+bool handles_equal(BodyHandle a, BodyHandle b) {
+    return a.index == b.index && a.generation == b.generation;
+}
+
+// Returns whether a pair creator acts between the two given bodies
+bool pair_matches(force_creator_info *info, BodyHandle body1,
+    BodyHandle body2) {
+    BodyHandle a = ARRAY_AT(&info->bodies, 0);
+    BodyHandle b = ARRAY_AT(&info->bodies, 1);
+    return (handles_equal(a, body1) && handles_equal(b, body2))
+        || (handles_equal(a, body2) && handles_equal(b, body1));
+}
+
+void pair_index_insert(Scene *scene, force_creator_info *info) {
+    size_t bucket = pair_bucket(scene, ARRAY_AT(&info->bodies, 0),
+        ARRAY_AT(&info->bodies, 1));
+    info->next_pair = scene->pair_buckets[bucket];
+    scene->pair_buckets[bucket] = info;
+}
+
+void pair_index_grow(Scene *scene) {
+    force_creator_info **old_buckets = scene->pair_buckets;
+    size_t old_count = scene->pair_bucket_count;
+    scene->pair_bucket_count *= INC_FACTOR;
+    scene->pair_buckets = calloc(scene->pair_bucket_count,
+        sizeof(force_creator_info *));
+    assert(scene->pair_buckets != NULL);
+
+    for (size_t i = 0; i < old_count; i++) {
+        force_creator_info *tmp = old_buckets[i];
+        while (tmp != NULL) {
+            force_creator_info *next = tmp->next_pair;
+            pair_index_insert(scene, tmp);
+            tmp = next;
+        }
+    }
+
+    free(old_buckets);
+}
+
+void pair_index_remove(Scene *scene, force_creator_info *info) {
+    size_t bucket = pair_bucket(scene, ARRAY_AT(&info->bodies, 0),
+        ARRAY_AT(&info->bodies, 1));
+    force_creator_info **link = &scene->pair_buckets[bucket];
+
+    while (*link != info) {
+        assert(*link != NULL);
+        link = &(*link)->next_pair;
+    }
+
+    *link = info->next_pair;
+    scene->pair_count--;
+}
+
+// Unregisters a pair creator that is about to be removed from the scene
+void forget_pair_creator(Scene *scene, force_creator_info *info) {
+    pair_index_remove(scene, info);
+
+    // Only creators invoked on this tick are in near_pairs
+    if (info->near_tick != scene->tick) {
+        return;
+    }
+    for (size_t i = 0; i < scene->near_pairs.size; i++) {
+        if (ARRAY_AT(&scene->near_pairs, i) == info) {
+            creator_array_swap_remove(&scene->near_pairs, i);
+            break;
+        }
+    }
+}
+
+/**
+ * Stops a force creator from being invoked again and frees its aux.
+ * A pair creator leaves the pair index and drops that reference right away;
+ * a creator in force_creators stays there until scene_tick() compacts it.
+ * The struct is freed once the creator lists of its bodies let go of it.
+ */
+void kill_creator(Scene *scene, force_creator_info *info) {
+    if (info->dead) {
+        return;
+    }
+    info->dead = true;
+
+    if (info->freer != NULL && info->aux != NULL) {
+        info->freer(info->aux);
+    }
+
+    if (info->is_pair) {
+        forget_pair_creator(scene, info);
+        body_handle_array_free(&info->bodies);
+        release_creator(info);
+    } else {
+        body_handle_array_free(&info->bodies);
+        scene->has_dead_creators = true;
+    }
+}
+
+void scene_free(Scene *scene) {
+    assert(scene != NULL);
+    for (size_t i = 0; i < scene->bodies.size; i++) {
+        body_free(ARRAY_AT(&scene->bodies, i));
+    }
+    body_array_free(&scene->bodies);
+
+    for (size_t i = 0; i < scene->pair_bucket_count; i++) {
+        force_creator_info *tmp = scene->pair_buckets[i];
+        while (tmp != NULL) {
+            force_creator_info *next = tmp->next_pair;
+            kill_creator(scene, tmp);
+            tmp = next;
+        }
+    }
+    for (size_t i = 0; i < scene->force_creators.size; i++) {
+        force_creator_info *tmp = ARRAY_AT(&scene->force_creators, i);
+        kill_creator(scene, tmp);
+        release_creator(tmp);
+    }
+    creator_array_free(&scene->force_creators);
+    for (size_t i = 0; i < scene->body_slots; i++) {
+        ForceCreatorArray *creators = &scene->body_creators[i];
+        for (size_t j = 0; j < creators->size; j++) {
+            release_creator(ARRAY_AT(creators, j));
+        }
+        creator_array_free(creators);
+    }
+    free(scene->body_creators);
+    spatial_hash_free(scene->grid);
+    if (scene->sweep != NULL) {
+        sweep_prune_free(scene->sweep);
+    }
+    if (scene->tree != NULL) {
+        aabb_tree_free(scene->tree);
+    }
+    free(scene->pair_buckets);
+    creator_array_free(&scene->near_pairs);
+    creator_array_free(&scene->prev_near_pairs);
+    creator_array_free(&scene->separated_pairs);
+    if (scene->pool != NULL) {
+        thread_pool_free(scene->pool);
+        task_graph_free(scene->narrowphase);
+    }
+    arena_free(scene->frame_arena);
+    for (size_t i = 0; i < scene->responses.size; i++) {
+        category_response *tmp = ARRAY_AT(&scene->responses, i);
+        if (tmp->freer != NULL && tmp->aux != NULL) {
+            tmp->freer(tmp->aux);
+        }
+        free(tmp);
+    }
+    response_array_free(&scene->responses);
+    collision_event_array_free(&scene->events);
+    contact_cache_free(scene->contacts);
+    free(scene);
+}
+
+// Marks a force creator with two bodies as a pair creator and indexes it
+void index_pair_creator(Scene *scene, force_creator_info *info) {
+    info->is_pair = true;
+
+    if (scene->pair_count == scene->pair_bucket_count) {
+        pair_index_grow(scene);
+    }
+    pair_index_insert(scene, info);
+    scene->pair_count++;
+}
+
+void scene_add_pair_force_creator(
+    Scene *scene, ForceCreator forcer, void *aux, List *bodies, FreeFunc freer
+) {
+    assert(scene != NULL && bodies != NULL && list_size(bodies) == 2);
+    index_pair_creator(scene, add_force_creator(scene, forcer, aux, bodies,
+        freer));
+}
+
+void scene_add_tested_pair_force_creator(
+    Scene *scene, ForceCreator forcer, PairTest test, void *aux, List *bodies,
+    FreeFunc freer
+) {
+    assert(scene != NULL && bodies != NULL && list_size(bodies) == 2);
+    assert(test != NULL);
+    force_creator_info *info = add_force_creator(scene, forcer, aux, bodies,
+        freer);
+    info->test = test;
+    index_pair_creator(scene, info);
+}
+
+void scene_add_category_response(Scene *scene, uint32_t category1,
+    uint32_t category2, ForceCreator forcer, PairTest test,
+    PairAuxInit aux_init, FreeFunc pair_freer, void *aux, FreeFunc freer) {
+    assert(scene != NULL && forcer != NULL && aux_init != NULL);
+    category_response *res = malloc(sizeof(category_response));
     assert(res != NULL);
+    res->category1 = category1;
+    res->category2 = category2;
     res->forcer = forcer;
+    res->test = test;
+    res->aux_init = aux_init;
+    res->pair_freer = pair_freer;
     res->aux = aux;
     res->freer = freer;
-    res->bodies = bodies;
-    list_add(scene->force_creators, res);
+    response_array_add(&scene->responses, res);
 }
 
+void scene_set_broadphase(Scene *scene, BroadphaseType type) {
+    assert(scene != NULL);
 
-BodyType get_bodytype(Scene *scene, size_t n) {
-    Body_info *tmp = body_get_info(scene_get_body(scene, n));
-    return (*tmp).b;
+    if (type == scene->broadphase) {
+        return;
+    }
+
+    if (scene->sweep != NULL) {
+        sweep_prune_free(scene->sweep);
+        scene->sweep = NULL;
+    }
+    if (scene->tree != NULL) {
+        aabb_tree_free(scene->tree);
+        scene->tree = NULL;
+    }
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
+        body_set_proxy(scene_get_body(scene, i), NO_PROXY);
+    }
+
+    // Bodies are added to a persistent broadphase lazily by run_broadphase()
+    if (type == BROADPHASE_SWEEP_AND_PRUNE) {
+        scene->sweep = sweep_prune_init();
+    } else if (type == BROADPHASE_AABB_TREE) {
+        scene->tree = aabb_tree_init(DEFAULT_TREE_MARGIN);
+    }
+    scene->broadphase = type;
 }
 
-void make_delay(int number_of_seconds)
-{
-    // Converting time into milli_seconds
-    int milli_seconds = 1000 * number_of_seconds;
+void scene_set_grid_cell_size(Scene *scene, double cell_size) {
+    assert(scene != NULL);
+    spatial_hash_set_cell_size(scene->grid, cell_size);
+}
 
-    // Storing start time
-    clock_t start_time = clock();
+Arena *scene_get_frame_arena(Scene *scene) {
+    assert(scene != NULL);
+    return scene->frame_arena;
+}
 
-    // looping till required time is not acheived
-    while (clock() < start_time + milli_seconds);
+void scene_add_collision_event(Scene *scene, CollisionEvent event) {
+    assert(scene != NULL);
+    collision_event_array_add(&scene->events, event);
 }
 
-void scene_tick(Scene *scene, double dt) {
+size_t scene_collision_events(Scene *scene) {
     assert(scene != NULL);
-    size_t ind = 0;
-    bool explosion = false;
+    return scene->events.size;
+}
+
+CollisionEvent scene_get_collision_event(Scene *scene, size_t index) {
+    assert(scene != NULL && index < scene->events.size);
+    return ARRAY_AT(&scene->events, index);
+}
+
+void scene_add_contact(Scene *scene, Body *body1, Body *body2, Vector axis,
+    double depth, double elasticity) {
+    assert(scene != NULL && body1 != NULL && body2 != NULL);
+    Contact *contact = contact_cache_add(scene->contacts,
+        body_get_handle(body1), body_get_handle(body2));
+    // Collision axes point either way, but the solver needs to know
+    // which way pushes the bodies apart
+    Vector offset = vec_subtract(body_get_centroid(body2),
+        body_get_centroid(body1));
+    contact->normal = vec_dot(axis, offset) < 0 ? vec_negate(axis) : axis;
+    contact->depth = depth;
+    contact->elasticity = elasticity;
+}
+
+void scene_set_contact_iterations(Scene *scene, size_t iterations) {
+    assert(scene != NULL);
+    scene->contact_iterations = iterations;
+}
+
+size_t scene_contacts(Scene *scene) {
+    assert(scene != NULL);
+    return contact_cache_size(scene->contacts);
+}
+
+Contact scene_get_contact(Scene *scene, size_t index) {
+    assert(scene != NULL);
+    return *contact_cache_get(scene->contacts, index);
+}
+
+// Returns whether a response has already added a pair creator between
+// two bodies
+bool has_response_creator(Scene *scene, category_response *response,
+    BodyHandle body1, BodyHandle body2) {
+    force_creator_info *tmp = scene->pair_buckets[
+        pair_bucket(scene, body1, body2)];
+
+    for (; tmp != NULL; tmp = tmp->next_pair) {
+        if (tmp->response == response && pair_matches(tmp, body1, body2)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Adds a pair creator between two nearby bodies for each category response
+ * they match that does not have one yet, and queues it to be invoked.
+ */
+void run_category_responses(Body *body1, Body *body2, Scene *scene) {
+    uint32_t category1 = body_get_category(body1);
+    uint32_t category2 = body_get_category(body2);
+
+    for (size_t i = 0; i < scene->responses.size; i++) {
+        category_response *response = ARRAY_AT(&scene->responses, i);
+        Body *first;
+        Body *second;
+
+        if ((category1 & response->category1)
+            && (category2 & response->category2)) {
+            first = body1;
+            second = body2;
+        } else if ((category2 & response->category1)
+            && (category1 & response->category2)) {
+            first = body2;
+            second = body1;
+        } else {
+            continue;
+        }
 
-    while (ind < list_size(scene->force_creators)) {
-        force_creator_info *tmp = list_get(scene->force_creators, ind);
-        // Flag whether this force creator should be removed
-        bool remove_force_creator = false;
-        // Apply force
+        BodyHandle handle1 = body_get_handle(first);
+        BodyHandle handle2 = body_get_handle(second);
+        if (has_response_creator(scene, response, handle1, handle2)) {
+            continue;
+        }
+
+        force_creator_info *info = new_force_creator(scene, response->forcer,
+            response->aux_init(first, second, response->aux),
+            response->pair_freer, 2);
+        add_creator_body(scene, info, handle1);
+        add_creator_body(scene, info, handle2);
+        info->test = response->test;
+        info->response = response;
+        index_pair_creator(scene, info);
+
+        info->near_tick = scene->tick;
+        creator_array_add(&scene->near_pairs, info);
+    }
+}
+
+/**
+ * PairCallback passed to the broadphase.
+ * Queues every pair creator registered between two nearby bodies
+ * to be invoked, unless their categories and masks say to skip them.
+ */
+void run_pair_creators(Body *body1, Body *body2, Scene *scene) {
+    if (!body_masks_match(body1, body2)) {
+        return;
+    }
+
+    BodyHandle handle1 = body_get_handle(body1);
+    BodyHandle handle2 = body_get_handle(body2);
+    force_creator_info *tmp = scene->pair_buckets[
+        pair_bucket(scene, handle1, handle2)];
+
+    for (; tmp != NULL; tmp = tmp->next_pair) {
+        if (pair_matches(tmp, handle1, handle2)) {
+            tmp->near_tick = scene->tick;
+            creator_array_add(&scene->near_pairs, tmp);
+        }
+    }
+
+    if (scene->responses.size > 0 && (body_get_category(body1) != 0
+        || body_get_category(body2) != 0)) {
+        run_category_responses(body1, body2, scene);
+    }
+}
+
+// Rebuilds the spatial hash from scratch and runs the pairs it finds
+void run_spatial_hash(Scene *scene) {
+    spatial_hash_clear(scene->grid);
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
+        Body *body = scene_get_body(scene, i);
+        spatial_hash_insert(scene->grid, body, body_get_aabb(body));
+    }
+    spatial_hash_find_pairs(scene->grid, (PairCallback) run_pair_creators,
+        scene);
+}
+
+/**
+ * Brings the sweep-and-prune broadphase up to date, adding any bodies
+ * it has not seen yet, and runs the pairs it finds.
+ */
+void run_sweep_prune(Scene *scene) {
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
+        Body *body = scene_get_body(scene, i);
+        size_t proxy = body_get_proxy(body);
+
+        if (proxy == NO_PROXY) {
+            body_set_proxy(body, sweep_prune_insert(scene->sweep, body,
+                body_get_aabb(body)));
+        } else {
+            sweep_prune_update(scene->sweep, proxy, body_get_aabb(body));
+        }
+    }
+    sweep_prune_find_pairs(scene->sweep, (PairCallback) run_pair_creators,
+        scene);
+}
+
+// Adds any new bodies to the AABB tree and updates the boxes of the rest
+void sync_aabb_tree(Scene *scene) {
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
+        Body *body = scene_get_body(scene, i);
+        size_t proxy = body_get_proxy(body);
+
+        if (proxy == NO_PROXY) {
+            body_set_proxy(body, aabb_tree_insert(scene->tree, body,
+                body_get_aabb(body)));
+        } else {
+            aabb_tree_update(scene->tree, proxy, body_get_aabb(body));
+        }
+    }
+}
+
+/**
+ * Brings the AABB tree up to date, adding any bodies it has not seen yet,
+ * and runs the pairs it finds.
+ * Bodies that stay inside their padded boxes leave the tree untouched.
+ */
+void run_aabb_tree(Scene *scene) {
+    sync_aabb_tree(scene);
+    aabb_tree_find_pairs(scene->tree, (PairCallback) run_pair_creators,
+        scene);
+}
+
+// RangeFunc running the tests of a range of queued pair creators
+void run_pair_tests(ForceCreatorArray *pairs, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        force_creator_info *info = ARRAY_AT(pairs, i);
+        if (info->test != NULL) {
+            info->test(info->aux);
+        }
+    }
+}
+
+// TaskFunc running the tests of the pairs found near each other
+void test_near_pairs(Scene *scene) {
+    thread_pool_for(scene->pool, scene->near_pairs.size, PAIR_TEST_GRAIN,
+        (RangeFunc) run_pair_tests, &scene->near_pairs);
+}
+
+// TaskFunc running the tests of the pairs that just separated
+void test_separated_pairs(Scene *scene) {
+    thread_pool_for(scene->pool, scene->separated_pairs.size,
+        PAIR_TEST_GRAIN, (RangeFunc) run_pair_tests, &scene->separated_pairs);
+}
+
+// RangeFunc refreshing the caches of a range of the scene's bodies
+void refresh_body_caches(Scene *scene, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        body_refresh_caches(ARRAY_AT(&scene->bodies, i));
+    }
+}
+
+/**
+ * Forces phase: invokes the force creators that run every tick,
+ * in the order they were added. Pair creators are run by the phases below.
+ */
+void apply_forces(Scene *scene) {
+    for (size_t i = 0; i < scene->force_creators.size; i++) {
+        force_creator_info *tmp = ARRAY_AT(&scene->force_creators, i);
         tmp->forcer(tmp->aux);
+    }
+}
+
+/**
+ * Broadphase phase: queues the pair creators whose bodies are near each
+ * other, using the broadphase to avoid looking at pairs that are far apart.
+ * Pairs that were near on the previous tick but no longer are
+ * get queued for one last call so they notice the bodies have separated.
+ *
+ * With threads, every body's caches are refreshed in parallel first,
+ * so that the narrowphase tests only read the bodies.
+ */
+void run_broadphase(Scene *scene) {
+    if (scene->pool != NULL) {
+        thread_pool_for(scene->pool, scene->bodies.size, REFRESH_GRAIN,
+            (RangeFunc) refresh_body_caches, scene);
+    }
 
-        for (size_t i = 0; i < list_size(tmp->bodies); i++) {
-            Body *body_tmp = list_get(tmp->bodies, i);
+    ForceCreatorArray tmp = scene->prev_near_pairs;
+    scene->prev_near_pairs = scene->near_pairs;
+    scene->near_pairs = tmp;
+    creator_array_clear(&scene->near_pairs);
 
-            if (body_is_removed(body_tmp)) {
-                remove_force_creator = true;
-            }
+    switch (scene->broadphase) {
+        case BROADPHASE_SPATIAL_HASH:
+            run_spatial_hash(scene);
+            break;
+        case BROADPHASE_SWEEP_AND_PRUNE:
+            run_sweep_prune(scene);
+            break;
+        case BROADPHASE_AABB_TREE:
+            run_aabb_tree(scene);
+            break;
+    }
+
+    creator_array_clear(&scene->separated_pairs);
+    for (size_t i = 0; i < scene->prev_near_pairs.size; i++) {
+        force_creator_info *info = ARRAY_AT(&scene->prev_near_pairs, i);
+        if (info->near_tick != scene->tick) {
+            creator_array_add(&scene->separated_pairs, info);
         }
+    }
+}
 
-        ind++;
+/**
+ * Narrowphase phase: runs the tests of the queued pair creators.
+ * With threads, the near and separated pairs are two independent tasks
+ * that each split their tests across the pool. Each test only writes
+ * to its own creator's aux, so the results do not depend on which thread
+ * ran it.
+ */
+void run_narrowphase(Scene *scene) {
+    if (scene->pool == NULL) {
+        run_pair_tests(&scene->near_pairs, 0, scene->near_pairs.size);
+        run_pair_tests(&scene->separated_pairs, 0,
+            scene->separated_pairs.size);
+        return;
     }
+    thread_pool_run_graph(scene->pool, scene->narrowphase);
+}
 
-    ind = 0;
+/**
+ * Resolve phase: invokes the queued pair creators in the order they were
+ * queued, so any impulses, removals or other side effects happen in
+ * the same order no matter how the tests were run.
+ * Pair creators added by category responses expire after their last call.
+ */
+void resolve_pairs(Scene *scene) {
+    for (size_t i = 0; i < scene->near_pairs.size; i++) {
+        force_creator_info *info = ARRAY_AT(&scene->near_pairs, i);
+        info->forcer(info->aux);
+    }
+    for (size_t i = 0; i < scene->separated_pairs.size; i++) {
+        force_creator_info *info = ARRAY_AT(&scene->separated_pairs, i);
+        info->forcer(info->aux);
+        if (info->response != NULL) {
+            kill_creator(scene, info);
+        }
+    }
+}
 
-    while (ind < list_size(scene->force_creators)) {
-        force_creator_info *tmp = list_get(scene->force_creators, ind);
-        // Flag whether this force creator should be removed
-        bool remove_force_creator = false;
+// The mass resisting an impulse between two bodies.
+// A body with infinite mass does not move, so only the other one counts.
+double contact_mass(Body *body1, Body *body2) {
+    double m1 = body_get_mass(body1);
+    double m2 = body_get_mass(body2);
+    if (m1 == INFINITY) {
+        return m2;
+    }
+    if (m2 == INFINITY) {
+        return m1;
+    }
+    return m1 * m2 / (m1 + m2);
+}
 
-        for (size_t i = 0; i < list_size(tmp->bodies); i++) {
-            Body *body_tmp = list_get(tmp->bodies, i);
+// The velocity a body will have at the end of the tick, once the forces
+// and impulses applied to it so far take effect
+Vector contact_velocity(Body *body, double dt) {
+    Vector velocity = body_get_velocity(body);
+    double mass = body_get_mass(body);
+    if (mass == INFINITY) {
+        return velocity;
+    }
+    Vector change = vec_add(body_get_impulse(body),
+        vec_multiply(dt, body_get_force(body)));
+    return vec_add(velocity, vec_multiply(1 / mass, change));
+}
+
+// Applies an impulse along a contact's normal, pushing the bodies apart
+void push_contact(Contact *contact, Body *body1, Body *body2,
+    double impulse) {
+    body_add_impulse(body1, vec_multiply(-impulse, contact->normal));
+    body_add_impulse(body2, vec_multiply(impulse, contact->normal));
+}
+
+// Bounces two bodies that have just started touching off each other
+void bounce_contact(Contact *contact, Body *body1, Body *body2) {
+    Vector normal = contact->normal;
+    double u_a = vec_dot(body_get_velocity(body1), normal);
+    double u_b = vec_dot(body_get_velocity(body2), normal);
+    double j = contact_mass(body1, body2) * (1 + contact->elasticity)
+        * (u_b - u_a);
+    body_add_impulse(body1, vec_multiply(j, normal));
+    body_add_impulse(body2, vec_multiply(-j, normal));
+}
+
+/**
+ * Solve phase: resolves the tick's contacts with impulses.
+ * New contacts bounce once. Lasting contacts first reapply the impulse
+ * they ended the last tick with, then each pass corrects it so the bodies
+ * stop moving into each other, keeping it non-negative so contacts only
+ * ever push. Starting from last tick's impulse means bodies that stay
+ * in contact (resting, or driven into a wall) need only small corrections,
+ * so a few passes converge. The passes count this tick's forces,
+ * so a body resting under gravity ends the tick at rest.
+ */
+void solve_contacts(Scene *scene, double dt) {
+    ContactCache *contacts = scene->contacts;
+    size_t count = contact_cache_size(contacts);
+
+    for (size_t i = 0; i < count; i++) {
+        Contact *contact = contact_cache_get(contacts, i);
+        Body *body1 = body_from_handle(contact->body1);
+        Body *body2 = body_from_handle(contact->body2);
+        if (contact->ticks == 1) {
+            bounce_contact(contact, body1, body2);
+        }
+        else if (contact->impulse > 0) {
+            push_contact(contact, body1, body2, contact->impulse);
+        }
+    }
 
-            if (body_is_removed(body_tmp)) {
-                remove_force_creator = true;
-                break;
+    for (size_t pass = 0; pass < scene->contact_iterations; pass++) {
+        for (size_t i = 0; i < count; i++) {
+            Contact *contact = contact_cache_get(contacts, i);
+            if (contact->ticks == 1) {
+                continue;
+            }
+            Body *body1 = body_from_handle(contact->body1);
+            Body *body2 = body_from_handle(contact->body2);
+            double approach = vec_dot(vec_subtract(
+                contact_velocity(body1, dt), contact_velocity(body2, dt)),
+                contact->normal);
+            double impulse = fmax(contact->impulse
+                + contact_mass(body1, body2) * approach, 0);
+            if (impulse != contact->impulse) {
+                push_contact(contact, body1, body2,
+                    impulse - contact->impulse);
+                contact->impulse = impulse;
             }
         }
+    }
+}
 
-        if (remove_force_creator) {
-            list_remove(scene->force_creators, ind);
-        } else {
-            ind++;
+/**
+ * Dispatch phase: calls the handlers of the tick's collision events
+ * in the order the events were queued. Removed bodies are only freed
+ * by the compact phase, so every event's bodies still resolve here.
+ */
+void dispatch_collisions(Scene *scene) {
+    for (size_t i = 0; i < scene->events.size; i++) {
+        CollisionEvent event = ARRAY_AT(&scene->events, i);
+        if (event.phase != COLLISION_BEGIN || event.handler == NULL) {
+            continue;
         }
+        event.handler(body_from_handle(event.body1),
+            body_from_handle(event.body2), event.normal, event.aux);
+    }
+}
+
+void scene_set_threads(Scene *scene, size_t threads) {
+    assert(scene != NULL);
+    if (scene->pool != NULL) {
+        thread_pool_free(scene->pool);
+        task_graph_free(scene->narrowphase);
+        scene->pool = NULL;
+        scene->narrowphase = NULL;
+    }
+    if (threads == 0) {
+        return;
+    }
+
+    scene->pool = thread_pool_init(threads);
+    // A THREAD_POOL_SERIAL build starts no threads, so skip the extra steps
+    // the scene only takes to share its work between them
+    if (thread_pool_threads(scene->pool) == 0) {
+        thread_pool_free(scene->pool);
+        scene->pool = NULL;
+        return;
+    }
+
+    scene->narrowphase = task_graph_init();
+    task_graph_add(scene->narrowphase, (TaskFunc) test_near_pairs, scene);
+    task_graph_add(scene->narrowphase, (TaskFunc) test_separated_pairs, scene);
+}
+
+ThreadPool *scene_get_thread_pool(Scene *scene) {
+    assert(scene != NULL);
+    return scene->pool;
+}
+
+// Removes a body that is about to be freed from the persistent broadphase
+void forget_body(Scene *scene, Body *body) {
+    size_t proxy = body_get_proxy(body);
+
+    if (proxy == NO_PROXY) {
+        return;
+    }
+
+    if (scene->sweep != NULL) {
+        sweep_prune_remove(scene->sweep, proxy);
+    } else if (scene->tree != NULL) {
+        aabb_tree_remove(scene->tree, proxy);
+    }
+    body_set_proxy(body, NO_PROXY);
+}
+
+void add_to_region_list(Body *body, List *bodies) {
+    list_add(bodies, body);
+}
+
+List *scene_query_region(Scene *scene, AABB region) {
+    assert(scene != NULL);
+    List *res = list_init(INIT_SIZE, NULL);
+
+    if (scene->tree != NULL) {
+        sync_aabb_tree(scene);
+        aabb_tree_query(scene->tree, region, (BodyCallback) add_to_region_list,
+            res);
+        return res;
+    }
+
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
+        Body *body = scene_get_body(scene, i);
+        if (aabb_overlaps(body_get_aabb(body), region)) {
+            list_add(res, body);
+        }
+    }
+    return res;
+}
+
+/**
+ * Kills the force creators of a body that is about to be freed,
+ * and releases the body's references to them.
+ */
+void kill_body_creators(Scene *scene, Body *body) {
+    size_t slot = body_get_handle(body).index;
+    if (slot >= scene->body_slots) {
+        return;
+    }
+
+    ForceCreatorArray *creators = &scene->body_creators[slot];
+    for (size_t i = 0; i < creators->size; i++) {
+        force_creator_info *info = ARRAY_AT(creators, i);
+        kill_creator(scene, info);
+        release_creator(info);
     }
+    creator_array_clear(creators);
+}
+
+/**
+ * Frees a body if it has been removed.
+ * Used to compact the scene's bodies in a single pass.
+ *
+ * @return whether the body was freed
+ */
+bool release_removed_body(Body *body, Scene *scene) {
+    if (!body_is_removed(body)) {
+        return false;
+    }
+
+    forget_body(scene, body);
+    kill_body_creators(scene, body);
+    body_free(body);
+    return true;
+}
+
+
+BodyType get_bodytype(Scene *scene, size_t n) {
+    return body_get_tag(scene_get_body(scene, n));
+}
 
-    ind = 0;
+void make_delay(int number_of_seconds)
+{
+    // Converting time into milli_seconds
+    int milli_seconds = 1000 * number_of_seconds;
 
-    for (int i = 0; i < scene_bodies(scene); i++) {
+    // Storing start time
+    clock_t start_time = clock();
+
+    // looping till required time is not acheived
+    while (clock() < start_time + milli_seconds);
+}
+
+/**
+ * Integrate phase: moves every body that has not been removed.
+ */
+void integrate_bodies(Scene *scene, double dt) {
+    body_tick_batch(scene->bodies.data, scene->bodies.size, dt, scene->pool);
+}
+
+/**
+ * Compact phase: frees the removed bodies. Freeing them kills their
+ * force creators, so force_creators only needs compacting if one of them
+ * died.
+ */
+void compact_scene(Scene *scene) {
+    body_array_remove_if(&scene->bodies,
+        (bool (*)(Body *, void *)) release_removed_body, scene);
+    if (scene->has_dead_creators) {
+        creator_array_remove_if(&scene->force_creators, release_if_dead, NULL);
+        scene->has_dead_creators = false;
+    }
+}
+
+// Spawns an explosion where a tank was destroyed, unless one is going already
+void run_explosions(Scene *scene) {
+    size_t ind = 0;
+    bool explosion = false;
+
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
         if (get_bodytype(scene, i) == EXPLOSION) {
             explosion = true;
         }
     }
 
-    while (ind < scene_bodies(scene)) {
-        Body *body_tmp = scene_get_body(scene, ind);
+    for (ind = 0; ind < scene_bodies(scene); ind++) {
+        Body *body_tmp = ARRAY_AT(&scene->bodies, ind);
 
         if (body_is_removed(body_tmp)) {
-            Body_info *body_i = body_get_info(body_tmp);
-            if (body_i->b == TWO && !explosion) {
+            BodyType type = body_get_tag(body_tmp);
+            if (type == TWO && !explosion) {
                 Mix_OpenAudio( 22050, MIX_DEFAULT_FORMAT, 2, 4096 );
                 Mix_Chunk *boom = Mix_LoadWAV("sounds/Explosion+3.wav");
                 Mix_FreeChunk(boom);
@@ -197,7 +1150,7 @@ void scene_tick(Scene *scene, double dt) {
                     sdl_render_scene(scene);
                 }
             }
-            else if (body_i->b == ONE && !explosion) {
+            else if (type == ONE && !explosion) {
                 Mix_OpenAudio( 22050, MIX_DEFAULT_FORMAT, 2, 4096 );
                 Mix_Chunk *boom = Mix_LoadWAV("sounds/Explosion+3.wav");
                 Mix_FreeChunk(boom);
@@ -213,11 +1166,31 @@ void scene_tick(Scene *scene, double dt) {
                     sdl_render_scene(scene);
                 }
             }
-            list_remove(scene->bodies, ind);
-            body_free(body_tmp);
-        } else {
-            body_tick(body_tmp, dt);
-            ind++;
         }
     }
 }
+
+/**
+ * Ticks a scene in phases: forces, broadphase, narrowphase, resolve,
+ * solve, dispatch, then integrate and compact. With threads (see scene_set_threads()),
+ * each phase whose work splits into independent pieces shares it out
+ * across the pool; the rest run on the calling thread.
+ */
+void scene_tick(Scene *scene, double dt) {
+    assert(scene != NULL);
+    scene->tick++;
+    arena_reset(scene->frame_arena);
+    collision_event_array_clear(&scene->events);
+    contact_cache_next_tick(scene->contacts);
+
+    apply_forces(scene);
+    run_broadphase(scene);
+    run_narrowphase(scene);
+    resolve_pairs(scene);
+    solve_contacts(scene, dt);
+    dispatch_collisions(scene);
+    // Explosions may add bodies, which the integrate phase also covers
+    run_explosions(scene);
+    integrate_bodies(scene, dt);
+    compact_scene(scene);
+}
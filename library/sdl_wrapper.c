@@ -81,34 +81,31 @@ void sdl_init(Vector min, Vector max) {
 }
 
 bool sdl_is_done(void) {
-    SDL_Event *event = malloc(sizeof(*event));
-    assert(event);
-    while (SDL_PollEvent(event)) {
-        switch (event->type) {
+    SDL_Event event;
+    while (SDL_PollEvent(&event)) {
+        switch (event.type) {
             case SDL_QUIT:
-                free(event);
                 return true;
             case SDL_KEYDOWN:
             case SDL_KEYUP:
                 // Skip the keypress if no handler is configured
                 // or an unrecognized key was pressed
                 if (!key_handler) break;
-                char key = get_keycode(event->key.keysym.sym);
+                char key = get_keycode(event.key.keysym.sym);
                 if (!key) break;
 
-                double timestamp = event->key.timestamp;
-                if (!event->key.repeat) {
+                double timestamp = event.key.timestamp;
+                if (!event.key.repeat) {
                     key_start_timestamp = timestamp;
                 }
                 KeyEventType type =
-                    event->type == SDL_KEYDOWN ? KEY_PRESSED : KEY_RELEASED;
+                    event.type == SDL_KEYDOWN ? KEY_PRESSED : KEY_RELEASED;
                 double held_time =
                     (timestamp - key_start_timestamp) / MS_PER_S;
                 key_handler(key, type, held_time, aux);
                 break;
         }
     }
-    free(event);
     return false;
 }
 
@@ -117,28 +114,43 @@ void sdl_clear(void) {
     SDL_RenderClear(renderer);
 }
 
+/**
+ * Computes how to map scene coordinates onto the window.
+ * The scene is scaled so it fits entirely in the window,
+ * with the center of the scene at the center of the window.
+ */
+void get_screen_transform(double *center_x, double *center_y, double *scale) {
+    int width, height;
+    SDL_GetWindowSize(window, &width, &height);
+    *center_x = width / 2.0;
+    *center_y = height / 2.0;
+    double x_scale = *center_x / max_diff.x,
+           y_scale = *center_y / max_diff.y;
+    *scale = x_scale < y_scale ? x_scale : y_scale;
+}
+
+// Draws a polygon that has already been converted to screen points
+void fill_screen_polygon(short *x_points, short *y_points, size_t n,
+    RGBColor color) {
+    assert(0 <= color.r && color.r <= 1);
+    assert(0 <= color.g && color.g <= 1);
+    assert(0 <= color.b && color.b <= 1);
+
+    // Draw polygon with the given color
+    filledPolygonRGBA(
+        renderer,
+        x_points, y_points, n,
+        color.r * 255, color.g * 255, color.b * 255, 255
+    );
+}
+
 void sdl_draw_polygon(List *points, RGBColor color) {
     // Check parameters
     size_t n = list_size(points);
     assert(n >= 3);
-    assert(0 <= color.r && color.r <= 1);
-    assert(0 <= color.g && color.g <= 1);
-    assert(0 <= color.b && color.b <= 1);
 
-    // Scale scene so it fits entirely in the window,
-    // with the center of the scene at the center of the window
-    int *width = malloc(sizeof(*width)),
-        *height = malloc(sizeof(*height));
-    assert(width);
-    assert(height);
-    SDL_GetWindowSize(window, width, height);
-    double center_x = *width / 2.0,
-           center_y = *height / 2.0;
-    free(width);
-    free(height);
-    double x_scale = center_x / max_diff.x,
-           y_scale = center_y / max_diff.y;
-    double scale = x_scale < y_scale ? x_scale : y_scale;
+    double center_x, center_y, scale;
+    get_screen_transform(&center_x, &center_y, &scale);
 
     // Convert each vertex to a point on screen
     short *x_points = malloc(sizeof(*x_points) * n),
@@ -154,14 +166,69 @@ void sdl_draw_polygon(List *points, RGBColor color) {
         y_points[i] = round(center_y - pos_from_center.y);
     }
 
-    // Draw polygon with the given color
-    filledPolygonRGBA(
+    fill_screen_polygon(x_points, y_points, n, color);
+    free(x_points);
+    free(y_points);
+}
+
+/**
+ * Converts a packed polygon to screen points and draws it.
+ * x_points and y_points must have room for all of the polygon's vertices.
+ */
+void draw_polygon_packed_with(Polygon *polygon, RGBColor color,
+    double center_x, double center_y, double scale,
+    short *x_points, short *y_points) {
+    size_t n = polygon->size;
+    assert(n >= 3);
+
+    // Convert each vertex to a point on screen
+    for (size_t i = 0; i < n; i++) {
+        Vector pos_from_center =
+            vec_multiply(scale, vec_subtract(polygon->vertices[i], center));
+        // Flip y axis since positive y is down on the screen
+        x_points[i] = round(center_x + pos_from_center.x);
+        y_points[i] = round(center_y - pos_from_center.y);
+    }
+
+    fill_screen_polygon(x_points, y_points, n, color);
+}
+
+void sdl_draw_polygon_packed(Polygon *polygon, RGBColor color) {
+    size_t n = polygon->size;
+    double center_x, center_y, scale;
+    get_screen_transform(&center_x, &center_y, &scale);
+
+    short *x_points = malloc(sizeof(*x_points) * n),
+          *y_points = malloc(sizeof(*y_points) * n);
+    assert(x_points);
+    assert(y_points);
+    draw_polygon_packed_with(polygon, color, center_x, center_y, scale,
+        x_points, y_points);
+    free(x_points);
+    free(y_points);
+}
+
+// Draws a circle given the screen transform computed by the caller
+void draw_circle_with(Vector position, double radius, RGBColor color,
+    double center_x, double center_y, double scale) {
+    assert(0 <= color.r && color.r <= 1);
+    assert(0 <= color.g && color.g <= 1);
+    assert(0 <= color.b && color.b <= 1);
+
+    Vector pos_from_center = vec_multiply(scale, vec_subtract(position, center));
+    filledCircleRGBA(
         renderer,
-        x_points, y_points, n,
+        round(center_x + pos_from_center.x),
+        round(center_y - pos_from_center.y),
+        round(radius * scale),
         color.r * 255, color.g * 255, color.b * 255, 255
     );
-    free(x_points);
-    free(y_points);
+}
+
+void sdl_draw_circle(Vector position, double radius, RGBColor color) {
+    double center_x, center_y, scale;
+    get_screen_transform(&center_x, &center_y, &scale);
+    draw_circle_with(position, radius, color, center_x, center_y, scale);
 }
 
 void sdl_show(void) {
@@ -170,13 +237,28 @@ void sdl_show(void) {
 
 void sdl_render_scene(Scene *scene) {
     sdl_clear();
+    double center_x, center_y, scale;
+    get_screen_transform(&center_x, &center_y, &scale);
+
+    // Screen points are scratch memory, released once the frame is drawn
+    Arena *arena = scene_get_frame_arena(scene);
+    size_t mark = arena_mark(arena);
     size_t body_count = scene_bodies(scene);
     for (size_t i = 0; i < body_count; i++) {
         Body *body = scene_get_body(scene, i);
-        List *shape = body_get_shape(body);
-        sdl_draw_polygon(shape, body_get_color(body));
-        list_free(shape);
+        if (body_get_shape_type(body) == SHAPE_CIRCLE) {
+            draw_circle_with(body_get_centroid(body), body_get_radius(body),
+                body_get_color(body), center_x, center_y, scale);
+            continue;
+        }
+
+        Polygon *polygon = body_borrow_polygon(body);
+        short *x_points = arena_alloc(arena, sizeof(*x_points) * polygon->size),
+              *y_points = arena_alloc(arena, sizeof(*y_points) * polygon->size);
+        draw_polygon_packed_with(polygon, body_get_color(body),
+            center_x, center_y, scale, x_points, y_points);
     }
+    arena_release(arena, mark);
     sdl_show();
 }
 
@@ -5,43 +5,55 @@
 #include "polygon.h"
 
 
+uint32_t body_type_category(BodyType bt) {
+    return (uint32_t) 1 << bt;
+}
+
+// Tags a body with its BodyType and puts it in the matching category
+void set_body_type(Body *body, BodyType bt) {
+    body_set_tag(body, bt);
+    body_set_category(body, body_type_category(bt));
+}
+
 Body *n_polygon_shape(size_t num_sides, double radius, double mass,
     RGBColor color, Vector centroid, BodyType bt) {
-    List *vertices = list_init(num_sides, (FreeFunc) vec_free);
+    Polygon *vertices = polygon_init(num_sides);
     double theta = 2 * M_PI / num_sides;
     Vector start = (Vector) {.x = radius, .y = 0};
     size_t i;
 
     for (i = 0; i < num_sides; i++) {
-        Vector tmp = vec_rotate(start, theta * i);
-        list_add(vertices, vec_init(tmp.x, tmp.y));
+        vertices->vertices[i] = vec_rotate(start, theta * i);
     }
-    Body_info *body_i = malloc(sizeof(Body_info));
-    body_i->b = bt;
+    Body *res = body_init_with_polygon(vertices, mass, color, NULL, NULL);
+    set_body_type(res, bt);
+    body_set_centroid(res, centroid);
+    return res;
+}
 
-    Body *res = body_init_with_info(vertices, mass, color, body_i, free);
+Body *circle_shape(double radius, double mass, RGBColor color,
+    Vector centroid, BodyType bt) {
+    Body *res = body_init_circle(radius, mass, color, NULL, NULL);
+    set_body_type(res, bt);
     body_set_centroid(res, centroid);
     return res;
 }
 
 Body *star_shape(size_t num_sides, double radius, double mass,
     RGBColor color, Vector centroid, BodyType bt) {
-    List *vertices = list_init(num_sides, (FreeFunc) vec_free);
+    Polygon *vertices = polygon_init(2 * num_sides);
     double theta = 2 * M_PI / num_sides;
     Vector start = (Vector) {.x = radius, .y = 0};
     Vector inside = (Vector) {.x = 2 * radius / 5, .y = 0};
     size_t i;
 
     for (i = 0; i < num_sides; i++) {
-        Vector tmp = vec_rotate(start, theta * i);
-        Vector tmp2 = vec_rotate(inside, theta * i + (theta / 2));
-        list_add(vertices, vec_init(tmp.x, tmp.y));
-        list_add(vertices, vec_init(tmp2.x, tmp2.y));
+        vertices->vertices[2 * i] = vec_rotate(start, theta * i);
+        vertices->vertices[2 * i + 1] =
+            vec_rotate(inside, theta * i + (theta / 2));
     }
-    Body_info *body_i = malloc(sizeof(Body_info));
-    body_i->b = bt;
-
-    Body *res = body_init_with_info(vertices, mass, color, body_i, free);
+    Body *res = body_init_with_polygon(vertices, mass, color, NULL, NULL);
+    set_body_type(res, bt);
     body_set_centroid(res, centroid);
     return res;
 }
@@ -63,29 +75,17 @@ Body *enemy_shape(size_t num_sides, double radius, Vector position) {
         Vector point = vec_rotate(*((Vector *) list_get(vertices, i-1)), angle_change);
         list_add(vertices, vec_init(point.x, point.y));
     }
-    Body_info *body_i = malloc(sizeof(Body_info));
-    body_i->b = ENEMY;
-
     // Mass is irrelevant
-    Body *res = body_init_with_info(vertices, 10, (RGBColor) {.r = 1, .g = 0, .b = 0}, body_i, free);
+    Body *res = body_init(vertices, 10, (RGBColor) {.r = 1, .g = 0, .b = 0});
+    set_body_type(res, ENEMY);
     body_set_centroid(res, position);
     return res;
 }
 
 Body *rectangle_shape(Vector centroid, double mass, double width, double height, RGBColor color, BodyType bt) {
-    List *vertices = list_init(4, (FreeFunc) vec_free);
-    double d_x = width / 2;
-    double d_y = height / 2;
-    list_add(vertices, vec_init(centroid.x - d_x, centroid.y + d_y));
-    list_add(vertices, vec_init(centroid.x - d_x, centroid.y - d_y));
-    list_add(vertices, vec_init(centroid.x + d_x, centroid.y - d_y));
-    list_add(vertices, vec_init(centroid.x + d_x, centroid.y + d_y));
     // Mass is irrelevant
-
-    Body_info *body_i = malloc(sizeof(Body_info));
-    body_i->b = bt;
-
-    Body *res = body_init_with_info(vertices, mass, color, body_i, free);
+    Body *res = body_init_box(width, height, mass, color, NULL, NULL);
+    set_body_type(res, bt);
     body_set_centroid(res, centroid);
     return res;
 }
@@ -0,0 +1,168 @@
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "spatial_hash.h"
+
+#define INIT_SIZE 64
+#define INC_FACTOR 2
+#define NO_ENTRY SIZE_MAX
+
+/**
+ * One body's membership in one grid cell.
+ *
+ * @param body   the body covering the cell.
+ * @param bounds the body's bounding box.
+ * @param cell_x the column of the cell.
+ * @param cell_y the row of the cell.
+ * @param next   the index of the next entry in the same bucket, or NO_ENTRY.
+ */
+typedef struct {
+    Body *body;
+    AABB bounds;
+    long cell_x;
+    long cell_y;
+    size_t next;
+} grid_entry;
+
+/**
+ * @param cell_size    the width and height of each cell.
+ * @param entries      every (body, cell) membership, in insertion order.
+ * @param size         the number of entries.
+ * @param capacity     the number of entries allocated.
+ * @param buckets      the first entry hashed to each bucket, or NO_ENTRY.
+ * @param bucket_count the number of buckets, always a power of two.
+ */
+struct spatial_hash {
+    double cell_size;
+    grid_entry *entries;
+    size_t size;
+    size_t capacity;
+    size_t *buckets;
+    size_t bucket_count;
+};
+
+SpatialHash *spatial_hash_init(double cell_size) {
+    assert(cell_size > 0);
+    SpatialHash *res = malloc(sizeof(SpatialHash));
+    assert(res != NULL);
+    res->cell_size = cell_size;
+    res->entries = malloc(INIT_SIZE * sizeof(grid_entry));
+    assert(res->entries != NULL);
+    res->size = 0;
+    res->capacity = INIT_SIZE;
+    res->buckets = malloc(INIT_SIZE * sizeof(size_t));
+    assert(res->buckets != NULL);
+    res->bucket_count = INIT_SIZE;
+    return res;
+}
+
+void spatial_hash_free(SpatialHash *hash) {
+    assert(hash != NULL);
+    free(hash->entries);
+    free(hash->buckets);
+    free(hash);
+}
+
+void spatial_hash_set_cell_size(SpatialHash *hash, double cell_size) {
+    assert(hash != NULL && cell_size > 0);
+    hash->cell_size = cell_size;
+    spatial_hash_clear(hash);
+}
+
+void spatial_hash_clear(SpatialHash *hash) {
+    assert(hash != NULL);
+    hash->size = 0;
+}
+
+// Returns the row or column of the cell containing a coordinate
+long cell_index(SpatialHash *hash, double coord) {
+    return (long) floor(coord / hash->cell_size);
+}
+
+// Returns the bucket that a cell is hashed into
+size_t cell_bucket(SpatialHash *hash, long cell_x, long cell_y) {
+    uint64_t h = (uint64_t) cell_x * 73856093u ^ (uint64_t) cell_y * 19349663u;
+    return (size_t) (h & (hash->bucket_count - 1));
+}
+
+void spatial_hash_insert(SpatialHash *hash, Body *body, AABB bounds) {
+    assert(hash != NULL && body != NULL);
+    long min_x = cell_index(hash, bounds.min.x);
+    long min_y = cell_index(hash, bounds.min.y);
+    long max_x = cell_index(hash, bounds.max.x);
+    long max_y = cell_index(hash, bounds.max.y);
+
+    for (long x = min_x; x <= max_x; x++) {
+        for (long y = min_y; y <= max_y; y++) {
+            if (hash->size == hash->capacity) {
+                hash->capacity *= INC_FACTOR;
+                hash->entries = realloc(hash->entries,
+                    hash->capacity * sizeof(grid_entry));
+                assert(hash->entries != NULL);
+            }
+
+            hash->entries[hash->size++] = (grid_entry) {.body = body,
+                .bounds = bounds, .cell_x = x, .cell_y = y, .next = NO_ENTRY};
+        }
+    }
+}
+
+/**
+ * Links every entry into the chain of its bucket.
+ * The bucket table is grown to keep about one entry per bucket.
+ */
+void link_buckets(SpatialHash *hash) {
+    if (hash->bucket_count < hash->size) {
+        while (hash->bucket_count < hash->size) {
+            hash->bucket_count *= INC_FACTOR;
+        }
+        hash->buckets = realloc(hash->buckets,
+            hash->bucket_count * sizeof(size_t));
+        assert(hash->buckets != NULL);
+    }
+
+    for (size_t i = 0; i < hash->bucket_count; i++) {
+        hash->buckets[i] = NO_ENTRY;
+    }
+
+    for (size_t i = 0; i < hash->size; i++) {
+        grid_entry *entry = &hash->entries[i];
+        size_t bucket = cell_bucket(hash, entry->cell_x, entry->cell_y);
+        entry->next = hash->buckets[bucket];
+        hash->buckets[bucket] = i;
+    }
+}
+
+void spatial_hash_find_pairs(
+    SpatialHash *hash, PairCallback callback, void *aux
+) {
+    assert(hash != NULL && callback != NULL);
+    link_buckets(hash);
+
+    // Each chain is built newest-first, so walking down the chain from an
+    // entry visits every earlier entry that may share its cell exactly once
+    for (size_t i = 0; i < hash->size; i++) {
+        grid_entry *entry = &hash->entries[i];
+
+        for (size_t j = entry->next; j != NO_ENTRY;
+            j = hash->entries[j].next) {
+            grid_entry *other = &hash->entries[j];
+
+            if (other->cell_x != entry->cell_x ||
+                other->cell_y != entry->cell_y ||
+                !aabb_overlaps(entry->bounds, other->bounds)) {
+                continue;
+            }
+
+            // Bodies that share several cells are only reported from the
+            // cell containing the bottom left corner of their overlap
+            double overlap_x = fmax(entry->bounds.min.x, other->bounds.min.x);
+            double overlap_y = fmax(entry->bounds.min.y, other->bounds.min.y);
+            if (cell_index(hash, overlap_x) == entry->cell_x &&
+                cell_index(hash, overlap_y) == entry->cell_y) {
+                callback(other->body, entry->body, aux);
+            }
+        }
+    }
+}
@@ -0,0 +1,246 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "sweep_prune.h"
+
+#define INIT_SIZE 64
+#define INC_FACTOR 2
+
+/**
+ * The left or right edge of a body's bounding box.
+ *
+ * @param value  the x-coordinate of the edge.
+ * @param proxy  the proxy whose box this edge belongs to.
+ * @param is_max whether this is the right edge.
+ */
+typedef struct {
+    double value;
+    size_t proxy;
+    bool is_max;
+} sap_endpoint;
+
+/**
+ * A body tracked by the broadphase.
+ *
+ * @param body         the body, or NULL if the proxy has been removed.
+ * @param bounds       the body's bounding box.
+ * @param active_index the proxy's position in the active list while sweeping.
+ * @param next_free    the next unused proxy, if this one is unused.
+ */
+typedef struct {
+    Body *body;
+    AABB bounds;
+    size_t active_index;
+    size_t next_free;
+} sap_proxy;
+
+/**
+ * @param endpoints     the edges of every box, sorted by x-coordinate.
+ * @param num_endpoints the number of endpoints.
+ * @param proxies       the proxies, indexed by the values returned to users.
+ * @param num_proxies   the number of proxy slots in use or free.
+ * @param free_proxy    the first unused proxy slot, or NO_PROXY.
+ * @param num_removed   the number of removed proxies whose endpoints remain.
+ * @param active        the proxies whose boxes span the current sweep position.
+ * @param num_active    the number of active proxies.
+ */
+struct sweep_prune {
+    sap_endpoint *endpoints;
+    size_t num_endpoints;
+    size_t endpoint_capacity;
+    sap_proxy *proxies;
+    size_t num_proxies;
+    size_t proxy_capacity;
+    size_t free_proxy;
+    size_t num_removed;
+    size_t *active;
+    size_t active_capacity;
+    size_t num_active;
+};
+
+SweepAndPrune *sweep_prune_init(void) {
+    SweepAndPrune *res = malloc(sizeof(SweepAndPrune));
+    assert(res != NULL);
+    res->endpoints = malloc(INIT_SIZE * sizeof(sap_endpoint));
+    res->proxies = malloc(INIT_SIZE * sizeof(sap_proxy));
+    res->active = malloc(INIT_SIZE * sizeof(size_t));
+    assert(res->endpoints != NULL && res->proxies != NULL &&
+        res->active != NULL);
+    res->num_endpoints = 0;
+    res->endpoint_capacity = INIT_SIZE;
+    res->num_proxies = 0;
+    res->proxy_capacity = INIT_SIZE;
+    res->free_proxy = NO_PROXY;
+    res->num_removed = 0;
+    res->active_capacity = INIT_SIZE;
+    res->num_active = 0;
+    return res;
+}
+
+void sweep_prune_free(SweepAndPrune *sap) {
+    assert(sap != NULL);
+    free(sap->endpoints);
+    free(sap->proxies);
+    free(sap->active);
+    free(sap);
+}
+
+// Takes an unused proxy slot, growing the proxy array if there is none
+size_t sap_allocate_proxy(SweepAndPrune *sap) {
+    if (sap->free_proxy != NO_PROXY) {
+        size_t res = sap->free_proxy;
+        sap->free_proxy = sap->proxies[res].next_free;
+        return res;
+    }
+
+    if (sap->num_proxies == sap->proxy_capacity) {
+        sap->proxy_capacity *= INC_FACTOR;
+        sap->proxies = realloc(sap->proxies,
+            sap->proxy_capacity * sizeof(sap_proxy));
+        assert(sap->proxies != NULL);
+    }
+
+    return sap->num_proxies++;
+}
+
+void sap_add_endpoint(SweepAndPrune *sap, double value, size_t proxy,
+    bool is_max) {
+    if (sap->num_endpoints == sap->endpoint_capacity) {
+        sap->endpoint_capacity *= INC_FACTOR;
+        sap->endpoints = realloc(sap->endpoints,
+            sap->endpoint_capacity * sizeof(sap_endpoint));
+        assert(sap->endpoints != NULL);
+    }
+
+    sap->endpoints[sap->num_endpoints++] = (sap_endpoint) {.value = value,
+        .proxy = proxy, .is_max = is_max};
+}
+
+size_t sweep_prune_insert(SweepAndPrune *sap, Body *body, AABB bounds) {
+    assert(sap != NULL && body != NULL);
+    size_t proxy = sap_allocate_proxy(sap);
+    sap->proxies[proxy] = (sap_proxy) {.body = body, .bounds = bounds,
+        .active_index = 0, .next_free = NO_PROXY};
+
+    // New endpoints go at the end and are moved into place by the next sort
+    sap_add_endpoint(sap, bounds.min.x, proxy, false);
+    sap_add_endpoint(sap, bounds.max.x, proxy, true);
+    return proxy;
+}
+
+void sweep_prune_remove(SweepAndPrune *sap, size_t proxy) {
+    assert(sap != NULL && proxy < sap->num_proxies);
+    assert(sap->proxies[proxy].body != NULL);
+    sap->proxies[proxy].body = NULL;
+    sap->num_removed++;
+}
+
+void sweep_prune_update(SweepAndPrune *sap, size_t proxy, AABB bounds) {
+    assert(sap != NULL && proxy < sap->num_proxies);
+    sap->proxies[proxy].bounds = bounds;
+}
+
+/**
+ * Refreshes each endpoint from its proxy's current box in one pass,
+ * dropping the endpoints of removed proxies and recycling their slots.
+ */
+void sap_refresh_endpoints(SweepAndPrune *sap) {
+    size_t kept = 0;
+
+    for (size_t i = 0; i < sap->num_endpoints; i++) {
+        sap_endpoint endpoint = sap->endpoints[i];
+        sap_proxy *proxy = &sap->proxies[endpoint.proxy];
+
+        if (proxy->body == NULL) {
+            // Each proxy has exactly one right edge, so it is freed once
+            if (endpoint.is_max) {
+                proxy->next_free = sap->free_proxy;
+                sap->free_proxy = endpoint.proxy;
+            }
+            continue;
+        }
+
+        endpoint.value = endpoint.is_max ? proxy->bounds.max.x
+            : proxy->bounds.min.x;
+        sap->endpoints[kept++] = endpoint;
+    }
+
+    sap->num_endpoints = kept;
+    sap->num_removed = 0;
+}
+
+// Whether endpoint e1 belongs strictly after endpoint e2 in the sorted list.
+// Left edges go first on ties, so boxes that only touch still overlap.
+bool sap_endpoint_after(sap_endpoint e1, sap_endpoint e2) {
+    return e1.value > e2.value || (e1.value == e2.value && e1.is_max &&
+        !e2.is_max);
+}
+
+/**
+ * Insertion sort, which is linear when only a few endpoints are out of order.
+ * Since bodies barely move between ticks, that is the usual case.
+ */
+void sap_sort_endpoints(SweepAndPrune *sap) {
+    for (size_t i = 1; i < sap->num_endpoints; i++) {
+        sap_endpoint key = sap->endpoints[i];
+        size_t j = i;
+
+        while (j > 0 && sap_endpoint_after(sap->endpoints[j - 1], key)) {
+            sap->endpoints[j] = sap->endpoints[j - 1];
+            j--;
+        }
+
+        sap->endpoints[j] = key;
+    }
+}
+
+void sap_activate(SweepAndPrune *sap, size_t proxy) {
+    if (sap->num_active == sap->active_capacity) {
+        sap->active_capacity *= INC_FACTOR;
+        sap->active = realloc(sap->active,
+            sap->active_capacity * sizeof(size_t));
+        assert(sap->active != NULL);
+    }
+
+    sap->proxies[proxy].active_index = sap->num_active;
+    sap->active[sap->num_active++] = proxy;
+}
+
+void sap_deactivate(SweepAndPrune *sap, size_t proxy) {
+    size_t index = sap->proxies[proxy].active_index;
+    size_t last = sap->active[--sap->num_active];
+    sap->active[index] = last;
+    sap->proxies[last].active_index = index;
+}
+
+void sweep_prune_find_pairs(
+    SweepAndPrune *sap, PairCallback callback, void *aux
+) {
+    assert(sap != NULL && callback != NULL);
+    sap_refresh_endpoints(sap);
+    sap_sort_endpoints(sap);
+
+    // Sweep left to right; every box whose left edge is passed while another
+    // box is active overlaps it along x, so only y remains to be checked
+    sap->num_active = 0;
+    for (size_t i = 0; i < sap->num_endpoints; i++) {
+        sap_endpoint endpoint = sap->endpoints[i];
+
+        if (endpoint.is_max) {
+            sap_deactivate(sap, endpoint.proxy);
+            continue;
+        }
+
+        sap_proxy *proxy = &sap->proxies[endpoint.proxy];
+        for (size_t j = 0; j < sap->num_active; j++) {
+            sap_proxy *other = &sap->proxies[sap->active[j]];
+
+            if (proxy->bounds.min.y <= other->bounds.max.y &&
+                proxy->bounds.max.y >= other->bounds.min.y) {
+                callback(other->body, proxy->body, aux);
+            }
+        }
+
+        sap_activate(sap, endpoint.proxy);
+    }
+}
@@ -0,0 +1,459 @@
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "array.h"
+#include "thread_pool.h"
+
+#define INIT_SIZE 64
+#define INC_FACTOR 2
+#define NO_EDGE SIZE_MAX
+
+/**
+ * A unit of work in a queue: run(data, index),
+ * after which the counter of the work it belongs to is decremented.
+ */
+typedef struct {
+    void (*run)(void *data, size_t index);
+    void *data;
+    size_t index;
+    atomic_size_t *pending;
+} job;
+
+/**
+ * A thread's double-ended queue of jobs.
+ * The owner pushes and pops at the back; thieves take from the front.
+ * The jobs are a ring buffer of size jobs starting at head.
+ */
+typedef struct {
+    ThreadPool *pool;
+    job *jobs;
+    size_t capacity;
+    size_t head;
+    size_t size;
+    pthread_mutex_t lock;
+} job_queue;
+
+/**
+ * @param threads      the worker threads.
+ * @param thread_count the number of worker threads.
+ * @param queues       one queue per worker, plus a last one shared by
+ *   threads outside the pool.
+ * @param queued       the number of jobs in all the queues.
+ * @param lock         guards sleeping, along with work_ready.
+ * @param work_ready   signaled when a job is queued or the pool stops.
+ * @param stopping     whether the workers should exit.
+ */
+struct thread_pool {
+    pthread_t *threads;
+    size_t thread_count;
+    job_queue *queues;
+    atomic_size_t queued;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    bool stopping;
+};
+
+/**
+ * A task of a task graph.
+ *
+ * @param func            the function to run.
+ * @param aux             the auxiliary value to pass to func.
+ * @param dependencies    the number of tasks this one waits for.
+ * @param first_dependent the first edge to a task waiting for this one.
+ */
+typedef struct {
+    TaskFunc func;
+    void *aux;
+    size_t dependencies;
+    size_t first_dependent;
+} graph_task;
+
+// An edge to a task waiting for another; next is the other's next edge
+typedef struct {
+    size_t task;
+    size_t next;
+} graph_edge;
+
+ARRAY_DEFINE(GraphTaskArray, graph_task, graph_task_array)
+ARRAY_DEFINE(GraphEdgeArray, graph_edge, graph_edge_array)
+
+/**
+ * @param tasks     the tasks, in the order they were added.
+ * @param edges     the edges of every task's list of dependents.
+ * @param remaining while running, how many tasks each task still waits for.
+ * @param remaining_capacity the number of counters remaining has room for.
+ * @param pending   while running, the counter of unfinished tasks.
+ */
+struct task_graph {
+    GraphTaskArray tasks;
+    GraphEdgeArray edges;
+    atomic_size_t *remaining;
+    size_t remaining_capacity;
+    atomic_size_t *pending;
+};
+
+// The queue of the worker running on this thread, if it is one
+_Thread_local job_queue *current_queue = NULL;
+
+void queue_init(job_queue *queue, ThreadPool *pool) {
+    queue->pool = pool;
+    queue->jobs = malloc(INIT_SIZE * sizeof(job));
+    assert(queue->jobs != NULL);
+    queue->capacity = INIT_SIZE;
+    queue->head = 0;
+    queue->size = 0;
+    pthread_mutex_init(&queue->lock, NULL);
+}
+
+void queue_free(job_queue *queue) {
+    free(queue->jobs);
+    pthread_mutex_destroy(&queue->lock);
+}
+
+// The queue the calling thread should push to and pop from
+job_queue *own_queue(ThreadPool *pool) {
+    if (current_queue != NULL && current_queue->pool == pool) {
+        return current_queue;
+    }
+    return &pool->queues[pool->thread_count];
+}
+
+void queue_push(ThreadPool *pool, job_queue *queue, job item) {
+    pthread_mutex_lock(&queue->lock);
+    if (queue->size == queue->capacity) {
+        // Unroll the ring into the new buffer so head goes back to 0
+        job *jobs = malloc(queue->capacity * INC_FACTOR * sizeof(job));
+        assert(jobs != NULL);
+        size_t first = queue->capacity - queue->head;
+        memcpy(jobs, queue->jobs + queue->head, first * sizeof(job));
+        memcpy(jobs + first, queue->jobs, queue->head * sizeof(job));
+        free(queue->jobs);
+        queue->jobs = jobs;
+        queue->head = 0;
+        queue->capacity *= INC_FACTOR;
+    }
+    queue->jobs[(queue->head + queue->size++) % queue->capacity] = item;
+    pthread_mutex_unlock(&queue->lock);
+
+    atomic_fetch_add(&pool->queued, 1);
+    if (pool->thread_count > 0) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_signal(&pool->work_ready);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+// Takes the newest job from the back of a queue, or the oldest from the front
+bool queue_take(ThreadPool *pool, job_queue *queue, bool newest,
+    job *item) {
+    bool res = false;
+    pthread_mutex_lock(&queue->lock);
+
+    if (queue->size > 0) {
+        if (newest) {
+            *item = queue->jobs[(queue->head + --queue->size)
+                % queue->capacity];
+        } else {
+            *item = queue->jobs[queue->head];
+            queue->head = (queue->head + 1) % queue->capacity;
+            queue->size--;
+        }
+        res = true;
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+    if (res) {
+        atomic_fetch_sub(&pool->queued, 1);
+    }
+    return res;
+}
+
+// Pops a job from a thread's own queue, or else steals one from another
+bool find_job(ThreadPool *pool, job_queue *own, job *item) {
+    if (queue_take(pool, own, true, item)) {
+        return true;
+    }
+
+    size_t queue_count = pool->thread_count + 1;
+    size_t start = own - pool->queues;
+    for (size_t i = 1; i < queue_count; i++) {
+        job_queue *victim = &pool->queues[(start + i) % queue_count];
+        if (queue_take(pool, victim, false, item)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void run_job(job item) {
+    atomic_size_t *pending = item.pending;
+    item.run(item.data, item.index);
+    atomic_fetch_sub(pending, 1);
+}
+
+// Runs jobs, including other threads', until a piece of work has finished
+void wait_for(ThreadPool *pool, atomic_size_t *pending) {
+    job_queue *own = own_queue(pool);
+    job item;
+
+    while (atomic_load(pending) > 0) {
+        if (find_job(pool, own, &item)) {
+            run_job(item);
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+void *pool_worker(job_queue *own) {
+    ThreadPool *pool = own->pool;
+    current_queue = own;
+    job item;
+
+    while (true) {
+        if (find_job(pool, own, &item)) {
+            run_job(item);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->stopping && atomic_load(&pool->queued) == 0) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        bool stopping = pool->stopping;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (stopping) {
+            return NULL;
+        }
+    }
+}
+
+ThreadPool *thread_pool_init(size_t threads) {
+#ifdef THREAD_POOL_SERIAL
+    threads = 0;
+#endif
+    ThreadPool *res = malloc(sizeof(ThreadPool));
+    assert(res != NULL);
+    res->threads = malloc((threads == 0 ? 1 : threads) * sizeof(pthread_t));
+    res->queues = malloc((threads + 1) * sizeof(job_queue));
+    assert(res->threads != NULL && res->queues != NULL);
+    res->thread_count = threads;
+    for (size_t i = 0; i <= threads; i++) {
+        queue_init(&res->queues[i], res);
+    }
+    atomic_init(&res->queued, 0);
+    pthread_mutex_init(&res->lock, NULL);
+    pthread_cond_init(&res->work_ready, NULL);
+    res->stopping = false;
+
+#ifndef THREAD_POOL_SERIAL
+    for (size_t i = 0; i < threads; i++) {
+        int err = pthread_create(&res->threads[i], NULL,
+            (void *(*)(void *)) pool_worker, &res->queues[i]);
+        assert(err == 0);
+    }
+#endif
+    return res;
+}
+
+void thread_pool_free(ThreadPool *pool) {
+    assert(pool != NULL);
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+#ifndef THREAD_POOL_SERIAL
+    for (size_t i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+#endif
+    for (size_t i = 0; i <= pool->thread_count; i++) {
+        queue_free(&pool->queues[i]);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    free(pool->queues);
+    free(pool->threads);
+    free(pool);
+}
+
+size_t thread_pool_threads(ThreadPool *pool) {
+    assert(pool != NULL);
+    return pool->thread_count;
+}
+
+/**
+ * A loop started by thread_pool_for(). It lives on the starting thread's
+ * stack, which is safe since that thread waits for the loop to finish.
+ *
+ * @param next the first iteration no thread has claimed yet.
+ */
+typedef struct {
+    RangeFunc func;
+    void *aux;
+    size_t count;
+    size_t grain;
+    atomic_size_t next;
+} parallel_loop;
+
+// A job that claims and runs chunks of a loop until none are left
+void run_loop_chunks(parallel_loop *loop, size_t index) {
+    while (true) {
+        size_t begin = atomic_fetch_add(&loop->next, loop->grain);
+        if (begin >= loop->count) {
+            return;
+        }
+
+        size_t end = begin + loop->grain;
+        loop->func(loop->aux, begin, end < loop->count ? end : loop->count);
+    }
+}
+
+void thread_pool_for(
+    ThreadPool *pool, size_t count, size_t grain, RangeFunc func, void *aux
+) {
+    assert(pool != NULL && grain > 0 && func != NULL);
+    if (pool->thread_count == 0 || count <= grain) {
+        func(aux, 0, count);
+        return;
+    }
+
+    parallel_loop loop = {.func = func, .aux = aux, .count = count,
+        .grain = grain};
+    atomic_init(&loop.next, 0);
+
+    // Chunks are claimed from a shared counter rather than queued one by one,
+    // so a loop only needs as many jobs as there are threads to run them
+    size_t chunks = (count + grain - 1) / grain;
+    size_t runners = chunks < pool->thread_count + 1
+        ? chunks : pool->thread_count + 1;
+    atomic_size_t pending;
+    atomic_init(&pending, runners);
+
+    job_queue *own = own_queue(pool);
+    for (size_t i = 1; i < runners; i++) {
+        queue_push(pool, own, (job) {
+            .run = (void (*)(void *, size_t)) run_loop_chunks,
+            .data = &loop, .index = i, .pending = &pending});
+    }
+    run_job((job) {.run = (void (*)(void *, size_t)) run_loop_chunks,
+        .data = &loop, .index = 0, .pending = &pending});
+    wait_for(pool, &pending);
+}
+
+TaskGraph *task_graph_init(void) {
+    TaskGraph *res = malloc(sizeof(TaskGraph));
+    assert(res != NULL);
+    graph_task_array_init(&res->tasks, INIT_SIZE);
+    graph_edge_array_init(&res->edges, INIT_SIZE);
+    res->remaining = malloc(INIT_SIZE * sizeof(atomic_size_t));
+    assert(res->remaining != NULL);
+    res->remaining_capacity = INIT_SIZE;
+    res->pending = NULL;
+    return res;
+}
+
+void task_graph_free(TaskGraph *graph) {
+    assert(graph != NULL);
+    graph_task_array_free(&graph->tasks);
+    graph_edge_array_free(&graph->edges);
+    free(graph->remaining);
+    free(graph);
+}
+
+void task_graph_clear(TaskGraph *graph) {
+    assert(graph != NULL);
+    graph_task_array_clear(&graph->tasks);
+    graph_edge_array_clear(&graph->edges);
+}
+
+size_t task_graph_add(TaskGraph *graph, TaskFunc func, void *aux) {
+    assert(graph != NULL && func != NULL);
+    graph_task_array_add(&graph->tasks, (graph_task) {.func = func,
+        .aux = aux, .dependencies = 0, .first_dependent = NO_EDGE});
+    return graph->tasks.size - 1;
+}
+
+void task_graph_depend(TaskGraph *graph, size_t task, size_t dependency) {
+    assert(graph != NULL && task < graph->tasks.size && dependency < task);
+    graph_task *before = &ARRAY_AT(&graph->tasks, dependency);
+    graph_edge_array_add(&graph->edges, (graph_edge) {.task = task,
+        .next = before->first_dependent});
+    before->first_dependent = graph->edges.size - 1;
+    ARRAY_AT(&graph->tasks, task).dependencies++;
+}
+
+void run_graph_task(TaskGraph *graph, size_t index);
+
+// Queues a task of a running graph on the calling thread's queue
+void queue_graph_task(ThreadPool *pool, TaskGraph *graph, size_t index) {
+    queue_push(pool, own_queue(pool), (job) {
+        .run = (void (*)(void *, size_t)) run_graph_task,
+        .data = graph, .index = index, .pending = graph->pending});
+}
+
+// The pool running each graph, so finished tasks can queue their dependents
+_Thread_local ThreadPool *current_graph_pool = NULL;
+
+/**
+ * Runs a task of a graph, then queues every task that was only waiting
+ * for it. A job's data has room for just one pointer, so the pool
+ * comes from the thread that started or is helping with the graph.
+ */
+void run_graph_task(TaskGraph *graph, size_t index) {
+    ThreadPool *pool = current_queue != NULL ? current_queue->pool
+        : current_graph_pool;
+    graph_task task = ARRAY_AT(&graph->tasks, index);
+    task.func(task.aux);
+
+    for (size_t e = task.first_dependent; e != NO_EDGE;
+        e = ARRAY_AT(&graph->edges, e).next) {
+        size_t dependent = ARRAY_AT(&graph->edges, e).task;
+        if (atomic_fetch_sub(&graph->remaining[dependent], 1) == 1) {
+            queue_graph_task(pool, graph, dependent);
+        }
+    }
+}
+
+void thread_pool_run_graph(ThreadPool *pool, TaskGraph *graph) {
+    assert(pool != NULL && graph != NULL);
+    size_t count = graph->tasks.size;
+    if (count == 0) {
+        return;
+    }
+
+    if (graph->remaining_capacity < count) {
+        free(graph->remaining);
+        graph->remaining = malloc(count * sizeof(atomic_size_t));
+        assert(graph->remaining != NULL);
+        graph->remaining_capacity = count;
+    }
+    for (size_t i = 0; i < count; i++) {
+        atomic_init(&graph->remaining[i],
+            ARRAY_AT(&graph->tasks, i).dependencies);
+    }
+
+    atomic_size_t pending;
+    atomic_init(&pending, count);
+    graph->pending = &pending;
+    // Restored afterwards in case this graph is running inside another's task
+    ThreadPool *outer_pool = current_graph_pool;
+    current_graph_pool = pool;
+
+    for (size_t i = 0; i < count; i++) {
+        if (ARRAY_AT(&graph->tasks, i).dependencies == 0) {
+            queue_graph_task(pool, graph, i);
+        }
+    }
+    wait_for(pool, &pending);
+
+    graph->pending = NULL;
+    current_graph_pool = outer_pool;
+}